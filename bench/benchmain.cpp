@@ -0,0 +1,349 @@
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "bmproutine.hpp"
+#include "colorconvert.hpp"
+#include "synthmul.hpp"
+#include "texturearchive.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+/* texture_bench
+ Generates a synthetic texidx.mul/texmaps.mul pair (see synthmul.hpp), and times each stage of an export on its own:
+    index_parse     opening the files, and reading and checking the index (TextureArchive)
+    payload_read    copying every texture's pixels out of texmaps.mul
+    header_build    building the BMP headers for every texture
+    row_convert     converting (to the depth) and flipping the rows of every texture
+    file_write      writing every texture's own BMP file (they are all encoded before the timing starts, so only the
+                    writing is measured, and they are all held in memory)
+ Each stage is run a number of times, and the fastest is reported (the one least disturbed by anything else running).
+ The results are written to stdout as JSON, so they can be compared from run to run.  MB is 1,000,000 bytes.
+ Only the files the bench made are removed afterwards (and the directories, if it made them and they are then empty).
+ It will not write over a texidx.mul/texmaps.mul that is already in the data directory, or into an output directory
+ that already has something in it, so pointing it at the client's directory by mistake does no harm.
+ */
+
+//======================================================================
+namespace {
+    // Where the stages leave a value made from what they produced, so the compiler can not decide the work is not needed
+    volatile std::uint32_t checksumSink = 0 ;
+    //==========================================================================================================================
+    struct BenchSettings {
+        SyntheticSettings data ;
+        int depth ;
+        int iterations ;
+        std::filesystem::path dataPath ;
+        std::filesystem::path outputPath ;
+        bool generateOnly ;
+        bool keep ;
+        bool help ;
+        BenchSettings():depth(16),iterations(5),dataPath("bench_data"),outputPath("bench_output"),generateOnly(false),keep(false),help(false) {
+        }
+    };
+    //==========================================================================================================================
+    struct StageResult {
+        std::string name ;
+        double seconds ;
+        std::size_t textures ;
+        std::size_t bytes ;
+    };
+    //==========================================================================================================================
+    auto usage() -> std::string {
+        return "Usage: texture_bench [options]\n"s +
+        "  --entries N            Number of index entries to generate (default 4096)\n"s +
+        "  --large-share F        Share (0-1) of the textures that are 128x128 (default 0.25)\n"s +
+        "  --invalid-share F      Share (0-1) of the entries that are unused (default 0.1)\n"s +
+        "  --duplicate-share F    Share (0-1) of the valid entries that repeat an earlier texture (default 0.1)\n"s +
+        "  --shared-share F       Share (0-1) of those that point at the earlier texture's data (default 0.5)\n"s +
+        "  --seed N               Seed for the generated data (default 1)\n"s +
+        "  --depth N              Bits per pixel to convert to and write: 16 (default), 24, or 32\n"s +
+        "  --iterations N         Times to run each stage, the fastest is reported (default 5)\n"s +
+        "  --data DIR             Where to write the generated files (default bench_data, must not have them already)\n"s +
+        "  --output DIR           Where to write the bmp files (default bench_output, must be empty or not exist)\n"s +
+        "  --generate-only        Only generate the files (and keep them)\n"s +
+        "  --keep                 Keep the generated files and the bmp files (otherwise they are removed afterwards)\n"s +
+        "  --help, -h             Show this usage\n"s ;
+    }
+    //==========================================================================================================================
+    auto parse(int argc, const char *argv[]) -> BenchSettings {
+        auto settings = BenchSettings() ;
+        auto arguments = std::vector<std::string>(argv + 1, argv + argc) ;
+        for (auto i = std::size_t(0) ; i < arguments.size() ; i++) {
+            auto argument = arguments[i] ;
+            auto value = std::string() ;
+            auto hasValue = false ;
+            auto equal = argument.find('=') ;
+            if (argument.size() > 2 && argument[0] == '-' && argument[1] == '-' && equal != std::string::npos) {
+                value = argument.substr(equal + 1) ;
+                argument = argument.substr(0, equal) ;
+                hasValue = true ;
+            }
+            auto next = [&]() -> std::string {
+                if (hasValue) {
+                    return value ;
+                }
+                if (i + 1 >= arguments.size()) {
+                    throw std::runtime_error("Missing value for "s + argument);
+                }
+                return arguments[++i] ;
+            };
+            auto number = [&]() -> unsigned long long {
+                auto text = next() ;
+                auto used = std::size_t(0) ;
+                auto result = 0ull ;
+                try {
+                    result = std::stoull(text, &used) ;
+                }
+                catch(...) {
+                    used = 0 ;
+                }
+                if (used == 0 || used != text.size() || text[0] == '-') {
+                    throw std::runtime_error("Invalid value for "s + argument + ": "s + text);
+                }
+                return result ;
+            };
+            auto share = [&]() -> double {
+                auto text = next() ;
+                auto used = std::size_t(0) ;
+                auto result = -1.0 ;
+                try {
+                    result = std::stod(text, &used) ;
+                }
+                catch(...) {
+                    used = 0 ;
+                }
+                if (used == 0 || used != text.size() || !(result >= 0.0 && result <= 1.0)) {
+                    throw std::runtime_error("Invalid value for "s + argument + ": "s + text + " (must be 0 to 1)"s);
+                }
+                return result ;
+            };
+            if (argument == "--help" || argument == "-h") {
+                settings.help = true ;
+            }
+            else if (argument == "--entries") {
+                settings.data.entries = static_cast<std::size_t>(number()) ;
+            }
+            else if (argument == "--large-share") {
+                settings.data.largeShare = share() ;
+            }
+            else if (argument == "--invalid-share") {
+                settings.data.invalidShare = share() ;
+            }
+            else if (argument == "--duplicate-share") {
+                settings.data.duplicateShare = share() ;
+            }
+            else if (argument == "--shared-share") {
+                settings.data.sharedShare = share() ;
+            }
+            else if (argument == "--seed") {
+                settings.data.seed = number() ;
+            }
+            else if (argument == "--depth") {
+                settings.depth = static_cast<int>(number()) ;
+                if (settings.depth != 16 && settings.depth != 24 && settings.depth != 32) {
+                    throw std::runtime_error("Invalid value for "s + argument + ": "s + std::to_string(settings.depth) + " (must be 16, 24, or 32)"s);
+                }
+            }
+            else if (argument == "--iterations") {
+                settings.iterations = static_cast<int>(std::min<unsigned long long>(number(), 1000)) ;
+                if (settings.iterations == 0) {
+                    throw std::runtime_error("Invalid value for "s + argument + ": 0"s);
+                }
+            }
+            else if (argument == "--data") {
+                settings.dataPath = next() ;
+            }
+            else if (argument == "--output") {
+                settings.outputPath = next() ;
+            }
+            else if (argument == "--generate-only") {
+                settings.generateOnly = true ;
+            }
+            else if (argument == "--keep") {
+                settings.keep = true ;
+            }
+            else {
+                throw std::runtime_error("Unknown option: "s + arguments[i] + "\n"s + usage());
+            }
+        }
+        return settings ;
+    }
+    //==========================================================================================================================
+    // Run the stage the given number of times, and keep the fastest
+    auto timeStage(const std::string &name, int iterations, std::size_t textures, std::size_t bytes, const std::function<void()> &stage) -> StageResult {
+        auto best = std::numeric_limits<double>::max() ;
+        for (auto run = 0 ; run < iterations ; run++) {
+            auto start = std::chrono::steady_clock::now() ;
+            stage();
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+            best = std::min(best, elapsed) ;
+        }
+        return StageResult{name, best, textures, bytes} ;
+    }
+    //==========================================================================================================================
+    auto rate(double amount, double seconds) -> double {
+        return seconds > 0.0 ? amount / seconds : 0.0 ;
+    }
+    //==========================================================================================================================
+    auto number(double value) -> std::string {
+        char text[64] ;
+        std::snprintf(text, sizeof(text), "%.6g", value);
+        return text ;
+    }
+    //==========================================================================================================================
+    auto settingsJson(const BenchSettings &settings, const SyntheticSummary &summary) -> std::string {
+        auto text = "  \"settings\": {\"entries\": "s + std::to_string(settings.data.entries) + ", \"large_share\": "s + number(settings.data.largeShare) + ", \"invalid_share\": "s + number(settings.data.invalidShare) + ", \"duplicate_share\": "s + number(settings.data.duplicateShare) + ", \"shared_share\": "s + number(settings.data.sharedShare) + ", \"seed\": "s + std::to_string(settings.data.seed) ;
+        text += ", \"depth\": "s + std::to_string(settings.depth) + ", \"iterations\": "s + std::to_string(settings.iterations) + ", \"kernel\": \""s + colorKernelName(bestColorKernel()) + "\"},\n"s ;
+        text += "  \"data\": {\"valid\": "s + std::to_string(summary.valid) + ", \"large\": "s + std::to_string(summary.large) + ", \"duplicates\": "s + std::to_string(summary.duplicates) + ", \"shared\": "s + std::to_string(summary.shared) + ", \"bytes\": "s + std::to_string(summary.dataBytes) + "}"s ;
+        return text ;
+    }
+    //==========================================================================================================================
+    auto stagesJson(const std::vector<StageResult> &results) -> std::string {
+        auto text = "  \"stages\": [\n"s ;
+        for (auto i = std::size_t(0) ; i < results.size() ; i++) {
+            const auto &result = results[i] ;
+            text += "    {\"name\": \""s + result.name + "\", \"seconds\": "s + number(result.seconds) + ", \"textures\": "s + std::to_string(result.textures) + ", \"bytes\": "s + std::to_string(result.bytes) ;
+            text += ", \"mb_per_s\": "s + number(rate(static_cast<double>(result.bytes) / 1000000.0, result.seconds)) + ", \"textures_per_s\": "s + number(rate(static_cast<double>(result.textures), result.seconds)) + "}"s ;
+            text += (i + 1 < results.size() ? ",\n"s : "\n"s) ;
+        }
+        return text + "  ]"s ;
+    }
+    //==========================================================================================================================
+    // The bmp files written are added to created, so they (and only they) can be removed afterwards
+    auto runStages(const BenchSettings &settings, std::vector<std::filesystem::path> &created) -> std::vector<StageResult> {
+        auto idxpath = settings.dataPath / std::filesystem::path("texidx.mul") ;
+        auto mulpath = settings.dataPath / std::filesystem::path("texmaps.mul") ;
+        auto results = std::vector<StageResult>() ;
+        auto archive = TextureArchive() ;
+        results.push_back(timeStage("index_parse", settings.iterations, 0, static_cast<std::size_t>(std::filesystem::file_size(idxpath)), [&]{
+            archive.open(idxpath, mulpath);
+        }));
+        results.back().textures = archive.size() ;
+
+        auto ids = std::vector<int>() ;
+        auto payload = std::size_t(0) ;
+        for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+            if (archive.valid(id)) {
+                ids.push_back(id);
+                payload += archive.view(id).size() ;
+            }
+        }
+        auto pixels = std::vector<std::uint16_t>(128 * 128) ;
+        auto checksum = std::uint32_t(0) ;
+        results.push_back(timeStage("payload_read", settings.iterations, ids.size(), payload, [&]{
+            for (auto id : ids) {
+                archive.decode(id, pixels.data(), pixels.size());
+                checksum += pixels[0] ;
+            }
+        }));
+
+        auto depth = static_cast<std::uint16_t>(settings.depth) ;
+        auto headerSize = bmpHeaderSize(depth) ;
+        auto buffer = std::vector<std::uint8_t>(headerSize + 128 * 128 * 4) ;
+        results.push_back(timeStage("header_build", settings.iterations, ids.size(), ids.size() * headerSize, [&]{
+            for (auto id : ids) {
+                writeBmpHeaders(buffer.data(), archive.entry(id).width(), archive.entry(id).width(), depth);
+                checksum += buffer[2] ;
+            }
+        }));
+
+        auto converted = std::size_t(0) ;
+        for (auto id : ids) {
+            converted += static_cast<std::size_t>(archive.entry(id).width()) * static_cast<std::size_t>(archive.entry(id).width()) * static_cast<std::size_t>(depth / 8) ;
+        }
+        results.push_back(timeStage("row_convert", settings.iterations, ids.size(), converted, [&]{
+            for (auto id : ids) {
+                auto texture = archive.view(id) ;
+                auto stride = static_cast<std::size_t>(texture.width) * static_cast<std::size_t>(depth / 8) ;
+                convertRows(texture.pixels, texture.width, texture.width, depth, buffer.data() + headerSize, stride) ;
+                checksum += buffer[headerSize] ;
+            }
+        }));
+
+        // Each texture's file is encoded beforehand, as only the writing is being timed
+        auto files = std::vector<std::pair<std::filesystem::path, FileData>>() ;
+        files.reserve(ids.size()) ;
+        auto written = std::size_t(0) ;
+        for (auto id : ids) {
+            char filestring[20] ;
+            std::snprintf(filestring, sizeof(filestring), "0x%04X.bmp", static_cast<unsigned>(id));
+            auto texture = archive.view(id) ;
+            files.emplace_back(settings.outputPath / std::filesystem::path(filestring), encodeBmp(texture.pixels, texture.width, depth));
+            written += files.back().second.size() ;
+        }
+        std::filesystem::create_directories(settings.outputPath);
+        results.push_back(timeStage("file_write", settings.iterations, ids.size(), written, [&]{
+            for (const auto &[path, data] : files) {
+                saveFile(path, data);
+            }
+        }));
+        for (const auto &file : files) {
+            created.push_back(file.first);
+        }
+        checksumSink = checksum ;
+        return results ;
+    }
+}
+
+//==============================================================================================================================
+int main(int argc, const char * argv[]) {
+    auto return_value = EXIT_SUCCESS ;
+    try {
+        auto settings = parse(argc, argv) ;
+        if (settings.help) {
+            std::cout << usage() ;
+            return return_value ;
+        }
+        // Checked before anything is written, so a mistake costs nothing
+        if (!settings.generateOnly && std::filesystem::exists(settings.outputPath) && !(std::filesystem::is_directory(settings.outputPath) && std::filesystem::is_empty(settings.outputPath))) {
+            throw std::runtime_error("Will not write into "s + settings.outputPath.string() + ", it is not an empty directory"s);
+        }
+        auto madeData = !std::filesystem::exists(settings.dataPath) ;
+        auto madeOutput = !std::filesystem::exists(settings.outputPath) ;
+        auto summary = writeSyntheticMul(settings.dataPath, settings.data) ;
+        auto results = std::vector<StageResult>() ;
+        if (!settings.generateOnly) {
+            auto created = std::vector<std::filesystem::path>() ;
+            results = runStages(settings, created) ;
+            if (!settings.keep) {
+                created.push_back(settings.dataPath / std::filesystem::path("texidx.mul"));
+                created.push_back(settings.dataPath / std::filesystem::path("texmaps.mul"));
+                auto error = std::error_code() ;
+                for (const auto &path : created) {
+                    std::filesystem::remove(path, error);
+                }
+                // These only go if we made them, and nothing else is in them (remove does not remove a directory that is not empty)
+                if (madeOutput) {
+                    std::filesystem::remove(settings.outputPath, error);
+                }
+                if (madeData) {
+                    std::filesystem::remove(settings.dataPath, error);
+                }
+            }
+        }
+        std::cout << "{\n" << settingsJson(settings, summary) << (settings.generateOnly ? "\n" : ",\n"s + stagesJson(results) + "\n"s) << "}" << std::endl;
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what()<< std::endl;
+        return_value = EXIT_FAILURE;
+    }
+    catch(...) {
+        std::cerr << "Unknown execption" << std::endl;
+        return_value = EXIT_FAILURE;
+    }
+    return return_value;
+}
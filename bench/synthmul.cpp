@@ -0,0 +1,149 @@
+//
+
+#include "synthmul.hpp"
+
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    // The standard distributions are allowed to differ between libraries, the engine is not.  So we make our own
+    // numbers from the engine's output, to get the same files everywhere.
+    class Random {
+        std::mt19937_64 engine ;
+    public:
+        explicit Random(std::uint64_t seed):engine(seed) {
+        }
+        auto chance(double share) -> bool {  // True share of the time
+            return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0) < share ;
+        }
+        auto below(std::uint64_t limit) -> std::uint64_t {
+            return engine() % limit ;
+        }
+        auto next() -> std::uint64_t {
+            return engine() ;
+        }
+    };
+    //==========================================================================================================================
+    auto put(std::vector<std::uint8_t> &buffer, std::uint32_t value) -> void {
+        for (auto i = 0 ; i < 4 ; i++) {
+            buffer.push_back(static_cast<std::uint8_t>((value >> (8*i)) & 0xFF));
+        }
+    }
+    //==========================================================================================================================
+    // Each texture has its own seed, so a duplicate can make the same pixels again
+    auto makeTexture(std::uint64_t seed, int width) -> std::vector<std::uint8_t> {
+        auto random = Random(seed) ;
+        auto pixels = std::vector<std::uint8_t>() ;
+        pixels.reserve(static_cast<std::size_t>(width) * static_cast<std::size_t>(width) * 2) ;
+        auto base = static_cast<std::uint32_t>(random.below(0x8000)) ;
+        for (auto i = 0 ; i < width * width ; i++) {
+            auto color = std::uint32_t(0) ;
+            if (!random.chance(0.05)) {
+                color = (base + static_cast<std::uint32_t>(i) * 7 + static_cast<std::uint32_t>(random.below(4))) & 0x7FFF ;
+            }
+            pixels.push_back(static_cast<std::uint8_t>(color & 0xFF));
+            pixels.push_back(static_cast<std::uint8_t>(color >> 8));
+        }
+        return pixels ;
+    }
+    //==========================================================================================================================
+    auto checkShare(const char *name, double share) -> void {
+        if (!(share >= 0.0 && share <= 1.0)) {
+            throw std::runtime_error("The "s + name + " must be between 0 and 1"s);
+        }
+    }
+}
+
+//==============================================================================================================================
+// SyntheticSettings
+//==============================================================================================================================
+//==============================================================================================================================
+SyntheticSettings::SyntheticSettings():entries(4096),largeShare(0.25),invalidShare(0.1),duplicateShare(0.1),sharedShare(0.5),seed(1) {
+}
+
+//==============================================================================================================================
+// writeSyntheticMul
+//==============================================================================================================================
+//==============================================================================================================================
+auto writeSyntheticMul(const std::filesystem::path &directory, const SyntheticSettings &settings) -> SyntheticSummary {
+    checkShare("large share", settings.largeShare);
+    checkShare("invalid share", settings.invalidShare);
+    checkShare("duplicate share", settings.duplicateShare);
+    checkShare("shared share", settings.sharedShare);
+    auto idxpath = directory / std::filesystem::path("texidx.mul") ;
+    auto mulpath = directory / std::filesystem::path("texmaps.mul") ;
+    for (const auto &path : {idxpath, mulpath}) {
+        if (std::filesystem::exists(path)) {
+            throw std::runtime_error("Will not write over "s + path.string() + " (remove it, or use another directory)"s);
+        }
+    }
+    std::filesystem::create_directories(directory);
+    auto mul = std::ofstream(mulpath.string(), std::ios::binary) ;
+    if (!mul.is_open()) {
+        throw std::runtime_error("Unable to create: "s + mulpath.string());
+    }
+    auto random = Random(settings.seed) ;
+    auto summary = SyntheticSummary{0, 0, 0, 0, 0} ;
+    auto index = std::vector<std::uint8_t>() ;
+    index.reserve(settings.entries * 12) ;
+    // The seed, flag, and offset of each texture written so far, so a duplicate can make one again (or use its data)
+    auto seeds = std::vector<std::uint64_t>() ;
+    auto flags = std::vector<std::uint32_t>() ;
+    auto offsets = std::vector<std::uint32_t>() ;
+    for (auto entry = std::size_t(0) ; entry < settings.entries ; entry++) {
+        if (random.chance(settings.invalidShare)) {
+            put(index, 0xFFFFFFFF);
+            put(index, 0);
+            put(index, 0);
+            continue ;
+        }
+        auto pick = std::size_t(0) ;
+        if (!seeds.empty() && random.chance(settings.duplicateShare)) {
+            pick = static_cast<std::size_t>(random.below(seeds.size())) ;
+            summary.duplicates++ ;
+            if (random.chance(settings.sharedShare)) {
+                auto width = std::uint32_t(flags[pick] == 1 ? 128 : 64) ;
+                put(index, offsets[pick]);
+                put(index, width * width * 2);
+                put(index, flags[pick]);
+                summary.shared++ ;
+                summary.valid++ ;
+                summary.large += flags[pick] ;
+                continue ;
+            }
+        }
+        else {
+            flags.push_back(random.chance(settings.largeShare) ? 1u : 0u);
+            seeds.push_back(random.next());
+            offsets.push_back(static_cast<std::uint32_t>(summary.dataBytes));
+            pick = seeds.size() - 1 ;
+        }
+        auto pixels = makeTexture(seeds[pick], flags[pick] == 1 ? 128 : 64) ;
+        put(index, static_cast<std::uint32_t>(summary.dataBytes));
+        put(index, static_cast<std::uint32_t>(pixels.size()));
+        put(index, flags[pick]);
+        mul.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        summary.dataBytes += pixels.size() ;
+        summary.valid++ ;
+        summary.large += flags[pick] ;
+        if (summary.dataBytes > 0xFFFFFFFF) {
+            throw std::runtime_error("Too many entries, texmaps.mul would be over 4GB"s);
+        }
+    }
+    if (!mul.good()) {
+        throw std::runtime_error("Unable to write: "s + mulpath.string());
+    }
+    auto idx = std::ofstream(idxpath.string(), std::ios::binary) ;
+    idx.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+    if (!idx.good()) {
+        throw std::runtime_error("Unable to write: "s + idxpath.string());
+    }
+    return summary ;
+}
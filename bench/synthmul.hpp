@@ -0,0 +1,49 @@
+//
+
+#ifndef synthmul_hpp
+#define synthmul_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+//==============================================================================================================================
+// Synthetic texture files
+//==============================================================================================================================
+/*
+ Writes a texidx.mul/texmaps.mul pair (laid out as described in texturearchive.hpp) made up of generated textures, so
+ the program can be measured without the real client files, and with a mix of entries we choose.
+
+ Each entry is, in turn, picked to be:
+    invalid         offset 0xFFFFFFFF, length 0 (invalidShare of them)
+    a duplicate     the pixels of an earlier (random) texture (duplicateShare of them).  Either written again at a new
+                    offset, or (sharedShare of the duplicates) the index entry just points at the earlier texture's
+                    data, the way the client files reuse a texture
+    a new texture   128x128 (flag 1, largeShare of them) or 64x64 (flag 0)
+ The pixels of a new texture are a noisy gradient, with about 1 in 20 pixels "no color", so they look a bit like
+ real textures to the compressors, and are not all the same.
+ The same settings (and seed) always give the same files, on any platform.
+ */
+struct SyntheticSettings {
+    std::size_t entries ;
+    double largeShare ;  // 0 to 1, of the textures
+    double invalidShare ;  // 0 to 1, of the entries
+    double duplicateShare ;  // 0 to 1, of the valid entries
+    double sharedShare ;  // 0 to 1, of the duplicates
+    std::uint64_t seed ;
+    SyntheticSettings() ;
+};
+
+struct SyntheticSummary {
+    std::size_t valid ;
+    std::size_t large ;
+    std::size_t duplicates ;
+    std::size_t shared ;  // Of the duplicates, how many share the offset of the earlier texture
+    std::size_t dataBytes ;  // The size of texmaps.mul
+};
+
+// Writes texidx.mul and texmaps.mul into the directory (which is created if needed).  Throws rather than write over
+// either file, if it is already there (so it can not replace real client files)
+auto writeSyntheticMul(const std::filesystem::path &directory, const SyntheticSettings &settings) -> SyntheticSummary ;
+
+#endif /* synthmul_hpp */
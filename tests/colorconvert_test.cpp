@@ -0,0 +1,144 @@
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "colorconvert.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+/* colorconvert_test
+ Checks that the SSE2 and AVX2 color kernels (see colorconvert.hpp) produce exactly the same bytes as the scalar one,
+ which is the reference:
+    convertRow      every count from 1 to 70 (so every length of tail after the 8 or 16 pixel blocks), 24 and 32 bit,
+                    both channel orders
+    convertRows     every width from 1 to 70, a few heights, 16, 24, and 32 bit, with padded rows
+    halveImage      every even width from 2 to 70, a few heights, and the full 64x64 and 128x128 textures
+ The pixels are random, mixed with the words that need special care: 0x0000 ("no color"), 0x8000 (also "no color",
+ the unused top bit is ignored) and 0x7FFF (white).  The output buffers are bigger than needed, and filled with a
+ marker first, so a kernel writing past the end (or into the padding) is caught as well.
+ A kernel the processor does not have is skipped.  Returns EXIT_FAILURE if anything differs.
+ */
+
+//======================================================================
+namespace {
+    constexpr auto guard = std::size_t(64) ;  // Extra bytes after each output, that must be left alone
+    constexpr auto marker = std::uint8_t(0xCD) ;
+    //==========================================================================================================================
+    struct Checker {
+        std::size_t checks = 0 ;
+        std::size_t failures = 0 ;
+        auto compare(bool same, const std::string &what) -> void {
+            checks++ ;
+            if (!same) {
+                failures++ ;
+                std::cerr << "Mismatch: " << what << std::endl;
+            }
+        }
+    };
+    //==========================================================================================================================
+    // Random pixels, with about a quarter of them being one of the special words
+    auto makePixels(std::mt19937 &random, std::size_t count) -> std::vector<std::uint16_t> {
+        static constexpr std::uint16_t special[] = {0x0000, 0x8000, 0x7FFF} ;
+        auto pixels = std::vector<std::uint16_t>(count) ;
+        for (auto &pixel : pixels) {
+            auto pick = random() ;
+            pixel = (pick % 4 == 0) ? special[(pick >> 8) % 3] : static_cast<std::uint16_t>(pick >> 16) ;
+        }
+        // Always have each of them at least once (at the end, where the tail code handles them)
+        for (auto i = std::size_t(0) ; i < count && i < 3 ; i++) {
+            pixels[count - 1 - i] = special[i] ;
+        }
+        return pixels ;
+    }
+    //==========================================================================================================================
+    auto describe(const char *function, ColorKernel kernel, int width, int height, int depth) -> std::string {
+        return function + " "s + colorKernelName(kernel) + " width "s + std::to_string(width) + " height "s + std::to_string(height) + " depth "s + std::to_string(depth) ;
+    }
+    //==========================================================================================================================
+    auto checkConvertRow(ColorKernel kernel, std::mt19937 &random, Checker &checker) -> void {
+        for (auto count = 1 ; count <= 70 ; count++) {
+            auto pixels = makePixels(random, static_cast<std::size_t>(count)) ;
+            for (auto depth : {24, 32}) {
+                for (auto order : {ChannelOrder::bgr, ChannelOrder::rgb}) {
+                    auto size = static_cast<std::size_t>(count) * static_cast<std::size_t>(depth / 8) + guard ;
+                    auto expected = std::vector<std::uint8_t>(size, marker) ;
+                    auto actual = std::vector<std::uint8_t>(size, marker) ;
+                    convertRow(ColorKernel::scalar, pixels.data(), count, depth, order, expected.data());
+                    convertRow(kernel, pixels.data(), count, depth, order, actual.data());
+                    checker.compare(expected == actual, describe("convertRow", kernel, count, 1, depth) + (order == ChannelOrder::rgb ? " rgb"s : " bgr"s));
+                }
+            }
+        }
+    }
+    //==========================================================================================================================
+    auto checkConvertRows(ColorKernel kernel, std::mt19937 &random, Checker &checker) -> void {
+        for (auto width = 1 ; width <= 70 ; width++) {
+            for (auto height : {1, 2, 3, 7}) {
+                auto pixels = makePixels(random, static_cast<std::size_t>(width) * static_cast<std::size_t>(height)) ;
+                for (auto depth : {16, 24, 32}) {
+                    // A BMP row is padded to 4 bytes, and then some more so the padding is checked too
+                    auto stride = ((static_cast<std::size_t>(width) * static_cast<std::size_t>(depth / 8) + 3) & ~std::size_t(3)) + 4 ;
+                    auto size = stride * static_cast<std::size_t>(height) + guard ;
+                    auto expected = std::vector<std::uint8_t>(size, marker) ;
+                    auto actual = std::vector<std::uint8_t>(size, marker) ;
+                    convertRows(ColorKernel::scalar, pixels.data(), width, height, depth, expected.data(), stride);
+                    convertRows(kernel, pixels.data(), width, height, depth, actual.data(), stride);
+                    checker.compare(expected == actual, describe("convertRows", kernel, width, height, depth));
+                }
+            }
+        }
+    }
+    //==========================================================================================================================
+    auto checkHalve(ColorKernel kernel, int width, int height, std::mt19937 &random, Checker &checker) -> void {
+        auto pixels = makePixels(random, static_cast<std::size_t>(width) * static_cast<std::size_t>(height)) ;
+        auto size = static_cast<std::size_t>(width / 2) * static_cast<std::size_t>(height / 2) + guard ;
+        auto expected = std::vector<std::uint16_t>(size, 0xCDCD) ;
+        auto actual = std::vector<std::uint16_t>(size, 0xCDCD) ;
+        halveImage(ColorKernel::scalar, pixels.data(), width, height, expected.data());
+        halveImage(kernel, pixels.data(), width, height, actual.data());
+        checker.compare(expected == actual, describe("halveImage", kernel, width, height, 16));
+    }
+    //==========================================================================================================================
+    auto checkHalveImage(ColorKernel kernel, std::mt19937 &random, Checker &checker) -> void {
+        for (auto width = 2 ; width <= 70 ; width += 2) {
+            for (auto height : {2, 4, 6}) {
+                checkHalve(kernel, width, height, random, checker);
+            }
+        }
+        checkHalve(kernel, 64, 64, random, checker);
+        checkHalve(kernel, 128, 128, random, checker);
+    }
+}
+
+//==============================================================================================================================
+int main() {
+    auto checker = Checker() ;
+    try {
+        for (auto kernel : {ColorKernel::sse2, ColorKernel::avx2}) {
+            if (!colorKernelAvailable(kernel)) {
+                std::cout << colorKernelName(kernel) << ": not available, skipped" << std::endl;
+                continue ;
+            }
+            // The same seed for each kernel, so a failure can be reproduced
+            auto random = std::mt19937(0x0555) ;
+            auto before = checker.failures ;
+            checkConvertRow(kernel, random, checker);
+            checkConvertRows(kernel, random, checker);
+            checkHalveImage(kernel, random, checker);
+            std::cout << colorKernelName(kernel) << ": " << (checker.failures == before ? "matches scalar"s : std::to_string(checker.failures - before) + " mismatches"s) << std::endl;
+        }
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what()<< std::endl;
+        return EXIT_FAILURE ;
+    }
+    std::cout << checker.checks << " checks, " << checker.failures << " failed" << std::endl;
+    return checker.failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
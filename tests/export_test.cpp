@@ -0,0 +1,145 @@
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bmproutine.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+/* export_test
+ Runs the texture program (its path is the one argument) on a small texidx.mul/texmaps.mul pair written here, and
+ checks the bmp files it leaves behind.
+ The pair has four 64x64 textures, the first three with the same pixels, so "--dedup link" writes 0x0000.bmp and makes
+ 0x0001.bmp and 0x0002.bmp hard links to it.  Then the pixels of id 1 are changed, and the program is run again
+ without any options.  It has to write a new file for each id, not write through the links: every file must have the
+ pixels of its own texture, and no link count above 1.  Done for each writer backend.
+ The files are made in export_test_data, in the current directory, which is removed first and afterwards.
+ Returns EXIT_FAILURE if anything is wrong.
+ */
+
+//======================================================================
+namespace {
+    constexpr auto width = 64 ;
+    constexpr auto textures = 4 ;
+    //==========================================================================================================================
+    struct Checker {
+        std::size_t checks = 0 ;
+        std::size_t failures = 0 ;
+        auto compare(bool same, const std::string &what) -> void {
+            checks++ ;
+            if (!same) {
+                failures++ ;
+                std::cerr << "Failed: " << what << std::endl;
+            }
+        }
+    };
+    //==========================================================================================================================
+    // A repeating ramp of colors, started at a different place for each seed, so each seed gives different pixels
+    auto makePixels(int seed) -> std::vector<std::uint16_t> {
+        auto pixels = std::vector<std::uint16_t>(static_cast<std::size_t>(width) * width) ;
+        for (auto i = std::size_t(0) ; i < pixels.size() ; i++) {
+            pixels[i] = static_cast<std::uint16_t>(((i + static_cast<std::size_t>(seed) * 1031) * 7) & 0x7FFF) ;
+        }
+        return pixels ;
+    }
+    //==========================================================================================================================
+    auto put32(std::ofstream &output, std::uint32_t value) -> void {
+        char bytes[4] = {static_cast<char>(value & 0xFF), static_cast<char>((value >> 8) & 0xFF), static_cast<char>((value >> 16) & 0xFF), static_cast<char>((value >> 24) & 0xFF)} ;
+        output.write(bytes, sizeof(bytes));
+    }
+    //==========================================================================================================================
+    // Each texture at its own offset (not shared), as 64x64 entries
+    auto writeMul(const std::filesystem::path &directory, const std::vector<std::vector<std::uint16_t>> &pixels) -> void {
+        std::filesystem::create_directories(directory);
+        auto index = std::ofstream(directory / "texidx.mul", std::ios::binary) ;
+        auto data = std::ofstream(directory / "texmaps.mul", std::ios::binary) ;
+        auto offset = std::uint32_t(0) ;
+        for (const auto &texture : pixels) {
+            auto length = static_cast<std::uint32_t>(texture.size() * sizeof(std::uint16_t)) ;
+            put32(index, offset);
+            put32(index, length);
+            put32(index, 0);
+            for (auto pixel : texture) {
+                char bytes[2] = {static_cast<char>(pixel & 0xFF), static_cast<char>(pixel >> 8)} ;
+                data.write(bytes, sizeof(bytes));
+            }
+            offset += length ;
+        }
+        if (!index || !data) {
+            throw std::runtime_error("Unable to write the test texidx.mul/texmaps.mul in "s + directory.string());
+        }
+    }
+    //==========================================================================================================================
+    auto readFile(const std::filesystem::path &path) -> FileData {
+        auto input = std::ifstream(path, std::ios::binary) ;
+        return FileData(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()) ;
+    }
+    //==========================================================================================================================
+    auto run(const std::string &program, const std::string &arguments) -> bool {
+        auto command = "\""s + program + "\" "s + arguments ;
+#if defined(_WIN32)
+        command = "\""s + command + "\""s ;  // cmd.exe drops the outer quotes
+#endif
+        return std::system(command.c_str()) == 0 ;
+    }
+    //==========================================================================================================================
+    // The file name the program gives a texture (there are fewer than 10 here)
+    auto name(int id) -> std::string {
+        return "0x000"s + std::to_string(id) + ".bmp"s ;
+    }
+    //==========================================================================================================================
+    auto checkLinkThenPlain(const std::string &program, const std::string &writer, Checker &checker) -> void {
+        auto pixels = std::vector<std::vector<std::uint16_t>>{makePixels(0), makePixels(0), makePixels(0), makePixels(3)} ;
+        writeMul("uodata", pixels);
+        checker.compare(run(program, "--dedup link --writer "s + writer), writer + ": the link export ran"s);
+        checker.compare(std::filesystem::exists(name(1)) && std::filesystem::hard_link_count(name(1)) == 3, writer + ": the link export linked 0x0001.bmp"s);
+        // Now id 1 is no longer the same as the others
+        pixels[1] = makePixels(1) ;
+        writeMul("uodata", pixels);
+        checker.compare(run(program, "--writer "s + writer), writer + ": the plain export ran"s);
+        for (auto id = 0 ; id < textures ; id++) {
+            auto expected = encodeBmp(pixels[static_cast<std::size_t>(id)].data(), width) ;
+            checker.compare(readFile(name(id)) == expected, writer + ": "s + name(id) + " has its own pixels"s);
+            checker.compare(std::filesystem::hard_link_count(name(id)) == 1, writer + ": "s + name(id) + " is not linked"s);
+        }
+    }
+}
+
+//==============================================================================================================================
+int main(int argc, const char * argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: export_test <path of the texture program>" << std::endl;
+        return EXIT_FAILURE ;
+    }
+    auto program = std::filesystem::absolute(argv[1]).string() ;
+    auto checker = Checker() ;
+    auto directory = std::filesystem::absolute("export_test_data") ;
+    try {
+        for (auto writer : {"stream"s, "pwrite"s, "auto"s}) {
+            std::filesystem::remove_all(directory);
+            std::filesystem::create_directories(directory);
+            std::filesystem::current_path(directory);
+            checkLinkThenPlain(program, writer, checker);
+            std::filesystem::current_path(directory.parent_path());
+        }
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what()<< std::endl;
+        checker.failures++ ;
+    }
+    std::filesystem::current_path(directory.parent_path());
+    auto error = std::error_code() ;
+    std::filesystem::remove_all(directory, error);
+    std::cout << checker.checks << " checks, " << checker.failures << " failed" << std::endl;
+    return checker.failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
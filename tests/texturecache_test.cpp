@@ -0,0 +1,238 @@
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "texturearchive.hpp"
+#include "texturecache.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+/* texturecache_test
+ Checks TextureCache (see texturecache.hpp) against a small texidx.mul/texmaps.mul pair written here: six 64x64
+ textures (ids 0 to 5, 8192 bytes of pixels each), one 128x128 (id 6, 32768 bytes), and an unused entry (id 7).
+    lru             the least recently used texture is the one dropped, and a hit makes a texture the most recent
+    capacity        the bytes held never go over the capacity, with textures of both sizes coming and going
+    counters        hits and misses are counted for every get, and clear empties the cache but keeps the counts
+    oversize        a texture bigger than the whole cache is returned, but not kept (and nothing is dropped for it)
+    concurrent      several threads getting the same ids at once all get the right pixels, and only one copy is kept
+ Every texture handed out is compared with the pixels written.  The files are made in texturecache_test_data, in
+ the current directory, which is removed first and afterwards.  Returns EXIT_FAILURE if anything is wrong.
+ */
+
+//======================================================================
+namespace {
+    constexpr auto small = std::size_t(64 * 64 * 2) ;  // Bytes of pixels in a 64x64 texture
+    constexpr auto large = std::size_t(128 * 128 * 2) ;
+    constexpr auto largeId = 6 ;
+    constexpr auto unusedId = 7 ;
+    //==========================================================================================================================
+    struct Checker {
+        std::size_t checks = 0 ;
+        std::size_t failures = 0 ;
+        auto compare(bool same, const std::string &what) -> void {
+            checks++ ;
+            if (!same) {
+                failures++ ;
+                std::cerr << "Failed: " << what << std::endl;
+            }
+        }
+    };
+    //==========================================================================================================================
+    // Different pixels for each id, so a texture handed out for the wrong id is caught
+    auto makePixels(int id, int width) -> std::vector<std::uint16_t> {
+        auto pixels = std::vector<std::uint16_t>(static_cast<std::size_t>(width) * static_cast<std::size_t>(width)) ;
+        for (auto i = std::size_t(0) ; i < pixels.size() ; i++) {
+            pixels[i] = static_cast<std::uint16_t>((i * 13 + static_cast<std::size_t>(id) * 977) & 0x7FFF) ;
+        }
+        return pixels ;
+    }
+    auto widthOf(int id) -> int {
+        return id == largeId ? 128 : 64 ;
+    }
+    //==========================================================================================================================
+    auto put32(std::ofstream &output, std::uint32_t value) -> void {
+        char bytes[4] = {static_cast<char>(value & 0xFF), static_cast<char>((value >> 8) & 0xFF), static_cast<char>((value >> 16) & 0xFF), static_cast<char>((value >> 24) & 0xFF)} ;
+        output.write(bytes, sizeof(bytes));
+    }
+    //==========================================================================================================================
+    auto writeMul(const std::filesystem::path &directory) -> void {
+        std::filesystem::create_directories(directory);
+        auto index = std::ofstream(directory / "texidx.mul", std::ios::binary) ;
+        auto data = std::ofstream(directory / "texmaps.mul", std::ios::binary) ;
+        auto offset = std::uint32_t(0) ;
+        for (auto id = 0 ; id < unusedId ; id++) {
+            auto pixels = makePixels(id, widthOf(id)) ;
+            auto length = static_cast<std::uint32_t>(pixels.size() * sizeof(std::uint16_t)) ;
+            put32(index, offset);
+            put32(index, length);
+            put32(index, id == largeId ? 1 : 0);
+            for (auto pixel : pixels) {
+                char bytes[2] = {static_cast<char>(pixel & 0xFF), static_cast<char>(pixel >> 8)} ;
+                data.write(bytes, sizeof(bytes));
+            }
+            offset += length ;
+        }
+        put32(index, 0xFFFFFFFF);
+        put32(index, 0);
+        put32(index, 0);
+        if (!index || !data) {
+            throw std::runtime_error("Unable to write the test texidx.mul/texmaps.mul in "s + directory.string());
+        }
+    }
+    //==========================================================================================================================
+    auto correct(const std::shared_ptr<const DecodedTexture> &texture, int id) -> bool {
+        auto expected = makePixels(id, widthOf(id)) ;
+        return texture != nullptr && texture->id == id && texture->width == widthOf(id) && texture->pixels.size() == expected.size() && std::equal(expected.begin(), expected.end(), texture->pixels.begin()) ;
+    }
+    //==========================================================================================================================
+    // Get an id, check its pixels, and that it was a hit (or a miss) as expected
+    auto expectGet(TextureCache &cache, int id, bool hit, const std::string &test, Checker &checker) -> void {
+        auto hits = cache.hits() ;
+        auto misses = cache.misses() ;
+        auto texture = cache.get(id) ;
+        checker.compare(correct(texture, id), test + ": the pixels of "s + std::to_string(id));
+        checker.compare(hit ? (cache.hits() == hits + 1 && cache.misses() == misses) : (cache.hits() == hits && cache.misses() == misses + 1), test + ": "s + std::to_string(id) + (hit ? " is a hit"s : " is a miss"s));
+    }
+    //==========================================================================================================================
+    auto checkLru(const TextureArchive &archive, Checker &checker) -> void {
+        auto cache = TextureCache(archive, 3 * small) ;
+        expectGet(cache, 0, false, "lru", checker);
+        expectGet(cache, 1, false, "lru", checker);
+        expectGet(cache, 2, false, "lru", checker);
+        expectGet(cache, 0, true, "lru", checker);  // Now 1 is the least recently used
+        expectGet(cache, 3, false, "lru", checker);  // So 1 is dropped
+        checker.compare(cache.size() == 3 && cache.bytes() == 3 * small, "lru: three textures held");
+        expectGet(cache, 0, true, "lru", checker);
+        expectGet(cache, 2, true, "lru", checker);
+        expectGet(cache, 3, true, "lru", checker);
+        expectGet(cache, 1, false, "lru", checker);  // Dropped 0, the least recently used after the hits above
+        expectGet(cache, 2, true, "lru", checker);
+        expectGet(cache, 0, false, "lru", checker);
+    }
+    //==========================================================================================================================
+    auto checkCapacity(const TextureArchive &archive, Checker &checker) -> void {
+        // Room for the large texture and one small one, but not two small ones with it
+        auto capacity = large + small + small / 2 ;
+        auto cache = TextureCache(archive, capacity) ;
+        for (auto id : {0, 1, 2, 3, 4, largeId, 5, 0, largeId, 1, 2, 3, largeId, 4}) {
+            cache.get(id);
+            checker.compare(cache.bytes() <= capacity, "capacity: after getting "s + std::to_string(id) + ", "s + std::to_string(cache.bytes()) + " bytes held"s);
+        }
+        // The large one last pushed out all but 3, and 4 then pushed out 3
+        checker.compare(cache.size() == 2 && cache.bytes() == large + small, "capacity: the large texture and one small one held");
+        expectGet(cache, largeId, true, "capacity", checker);
+        expectGet(cache, 4, true, "capacity", checker);
+        expectGet(cache, 3, false, "capacity", checker);  // Pushes out the large one, the least recently used
+        checker.compare(cache.size() == 2 && cache.bytes() == 2 * small, "capacity: the large texture dropped for a small one");
+        expectGet(cache, largeId, false, "capacity", checker);
+    }
+    //==========================================================================================================================
+    auto checkCounters(const TextureArchive &archive, Checker &checker) -> void {
+        auto cache = TextureCache(archive, 10 * large) ;
+        checker.compare(cache.hits() == 0 && cache.misses() == 0 && cache.size() == 0 && cache.bytes() == 0, "counters: a new cache is empty");
+        for (auto round = 0 ; round < 3 ; round++) {
+            for (auto id = 0 ; id < unusedId ; id++) {
+                cache.get(id);
+            }
+        }
+        checker.compare(cache.misses() == unusedId && cache.hits() == 2 * unusedId, "counters: one miss, then hits, for each id");
+        checker.compare(cache.size() == unusedId && cache.bytes() == (unusedId - 1) * small + large, "counters: every texture held");
+        auto threw = false ;
+        try {
+            cache.get(unusedId);
+        }
+        catch(const std::exception &) {
+            threw = true ;
+        }
+        checker.compare(threw, "counters: an unused entry throws");
+        cache.clear();
+        checker.compare(cache.size() == 0 && cache.bytes() == 0, "counters: clear empties the cache");
+        checker.compare(cache.misses() == unusedId + 1 && cache.hits() == 2 * unusedId, "counters: clear keeps the counts");
+        expectGet(cache, 0, false, "counters", checker);
+    }
+    //==========================================================================================================================
+    auto checkOversize(const TextureArchive &archive, Checker &checker) -> void {
+        auto cache = TextureCache(archive, 2 * small) ;
+        expectGet(cache, 0, false, "oversize", checker);
+        expectGet(cache, 1, false, "oversize", checker);
+        auto texture = cache.get(largeId) ;
+        checker.compare(correct(texture, largeId), "oversize: the pixels of the large texture");
+        checker.compare(cache.size() == 2 && cache.bytes() == 2 * small, "oversize: the large texture is not kept");
+        expectGet(cache, largeId, false, "oversize", checker);
+        expectGet(cache, 0, true, "oversize", checker);
+        expectGet(cache, 1, true, "oversize", checker);
+        // A texture handed out stays valid after it is dropped
+        auto first = cache.get(0) ;
+        cache.clear();
+        checker.compare(correct(first, 0), "oversize: a texture dropped from the cache is still valid");
+    }
+    //==========================================================================================================================
+    auto checkConcurrent(const TextureArchive &archive, Checker &checker) -> void {
+        constexpr auto threads = 8 ;
+        constexpr auto rounds = 200 ;
+        auto cache = TextureCache(archive, 10 * large) ;
+        auto wrong = std::vector<int>(threads, 0) ;
+        auto workers = std::vector<std::thread>() ;
+        for (auto thread = 0 ; thread < threads ; thread++) {
+            workers.emplace_back([&cache, &wrong, thread]{
+                for (auto round = 0 ; round < rounds ; round++) {
+                    // Every thread wants id 0 each time, and a few others, so they often miss on the same one together
+                    for (auto id : {0, round % 3 + 1, 0, largeId}) {
+                        if (!correct(cache.get(id), id)) {
+                            wrong[static_cast<std::size_t>(thread)]++ ;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        auto total = 0 ;
+        for (auto count : wrong) {
+            total += count ;
+        }
+        checker.compare(total == 0, "concurrent: "s + std::to_string(total) + " textures with the wrong pixels"s);
+        checker.compare(cache.hits() + cache.misses() == static_cast<std::size_t>(threads * rounds * 4), "concurrent: every get counted");
+        checker.compare(cache.misses() >= 5, "concurrent: at least one miss for each id");
+        checker.compare(cache.size() == 5 && cache.bytes() == 4 * small + large, "concurrent: one copy of each texture kept");
+        auto held = cache.get(0) ;
+        checker.compare(held == cache.get(0), "concurrent: the same copy handed out afterwards");
+    }
+}
+
+//==============================================================================================================================
+int main() {
+    auto checker = Checker() ;
+    auto directory = std::filesystem::absolute("texturecache_test_data") ;
+    try {
+        std::filesystem::remove_all(directory);
+        writeMul(directory);
+        auto archive = TextureArchive(directory / "texidx.mul", directory / "texmaps.mul") ;
+        checkLru(archive, checker);
+        checkCapacity(archive, checker);
+        checkCounters(archive, checker);
+        checkOversize(archive, checker);
+        checkConcurrent(archive, checker);
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what()<< std::endl;
+        checker.failures++ ;
+    }
+    auto error = std::error_code() ;
+    std::filesystem::remove_all(directory, error);
+    std::cout << checker.checks << " checks, " << checker.failures << " failed" << std::endl;
+    return checker.failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
@@ -0,0 +1,153 @@
+//
+
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "stats.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    auto put(FileData &buffer, std::uint32_t value, int size) -> void {
+        for (auto i = 0 ; i < size ; i++) {
+            buffer.push_back(static_cast<std::uint8_t>((value >> (8*i)) & 0xFF));
+        }
+    }
+}
+
+//==============================================================================================================================
+// AtlasBuilder
+//==============================================================================================================================
+//==============================================================================================================================
+AtlasBuilder::AtlasBuilder(int pageSize, const std::string &extension):pageSize(pageSize),extension(extension) {
+}
+//==============================================================================================================================
+auto AtlasBuilder::pageName(int page) const -> std::string {
+    char filestring[32] ;
+    std::snprintf(filestring, sizeof(filestring), "atlas_%02d", page);
+    return filestring + extension ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::place(int id, int size, int level) -> AtlasPlacement {
+    if (size <= 0 || size > pageSize) {
+        char idstring[7] ;
+        std::snprintf(idstring, sizeof(idstring), "0x%04X", static_cast<unsigned>(id));
+        throw std::runtime_error("Texture "s + idstring + " does not fit on an atlas page of "s + std::to_string(pageSize) + " pixels"s);
+    }
+    auto columns = pageSize / size ;
+    auto iter = sizes.find(size) ;
+    if (iter == sizes.end()) {
+        iter = sizes.insert(std::make_pair(size, SizeClass{-1, 0})).first ;
+    }
+    auto &sizeclass = iter->second ;
+    // Start a new page if we do not have one for this size, or it is full
+    if (sizeclass.page < 0 || sizeclass.next == columns * columns) {
+        pages.push_back(Page{size, 0, 0, 0, std::vector<std::uint16_t>()});
+        sizeclass.page = static_cast<int>(pages.size()) - 1 ;
+        sizeclass.next = 0 ;
+    }
+    auto cell = sizeclass.next++ ;
+    pages[static_cast<std::size_t>(sizeclass.page)].count++ ;
+    placements.push_back(AtlasPlacement{id, sizeclass.page, (cell % columns) * size, (cell / columns) * size, size, level});
+    return placements.back() ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::alias(int id, const AtlasPlacement &same) -> AtlasPlacement {
+    auto placement = same ;
+    placement.id = id ;
+    aliases.push_back(placement);
+    return placement ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::allocate() -> void {
+    for (auto number = std::size_t(0) ; number < pages.size() ; number++) {
+        auto &page = pages[number] ;
+        auto columns = pageSize / page.cell ;
+        page.width = std::min(columns, page.count) * page.cell ;
+        page.height = ((page.count + columns - 1) / columns) * page.cell ;
+        page.pixels = std::vector<std::uint16_t>(static_cast<std::size_t>(page.width) * static_cast<std::size_t>(page.height), 0) ;
+        Stats::allocated(page.pixels.size() * sizeof(std::uint16_t));
+    }
+}
+//==============================================================================================================================
+auto AtlasBuilder::draw(const AtlasPlacement &placement, const std::uint16_t *pixels) -> void {
+    auto &page = pages.at(static_cast<std::size_t>(placement.page)) ;
+    auto size = static_cast<std::size_t>(placement.size) ;
+    auto output = page.pixels.data() + static_cast<std::size_t>(placement.y) * static_cast<std::size_t>(page.width) + static_cast<std::size_t>(placement.x) ;
+    for (auto line = std::size_t(0) ; line < size ; line++) {
+        std::memcpy(output + line * static_cast<std::size_t>(page.width), pixels + line * size, size * sizeof(std::uint16_t)) ;
+    }
+}
+//==============================================================================================================================
+auto AtlasBuilder::entries() const -> const std::vector<AtlasPlacement>& {
+    return placements ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::table() const -> std::vector<AtlasPlacement> {
+    auto all = placements ;
+    all.insert(all.end(), aliases.begin(), aliases.end());
+    std::sort(all.begin(), all.end(), [](const AtlasPlacement &a, const AtlasPlacement &b){ return a.id < b.id || (a.id == b.id && a.level < b.level) ;});
+    return all ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::pageCount() const -> std::size_t {
+    return pages.size() ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::encodePage(std::size_t page, const ImageEncoder &encoder) -> OutputFile {
+    auto &current = pages.at(page) ;
+    auto file = OutputFile{pageName(static_cast<int>(page)), encoder.encode(current.pixels.data(), current.width, current.height)} ;
+    Stats::allocated(file.data.capacity());
+    current.pixels = std::vector<std::uint16_t>() ;
+    return file ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::binaryTable() const -> OutputFile {
+    auto file = OutputFile{"atlas.bin"s, FileData()} ;
+    auto textures = table() ;
+    auto &data = file.data ;
+    data.reserve(16 + pages.size() * 8 + textures.size() * 16) ;
+    put(data, 0x54415854, 4) ;  // 'TXAT'
+    put(data, 2, 4) ;
+    put(data, static_cast<std::uint32_t>(pages.size()), 4) ;
+    put(data, static_cast<std::uint32_t>(textures.size()), 4) ;
+    for (const auto &page : pages) {
+        put(data, static_cast<std::uint32_t>(page.width), 4) ;
+        put(data, static_cast<std::uint32_t>(page.height), 4) ;
+    }
+    for (const auto &placement : textures) {
+        put(data, static_cast<std::uint32_t>(placement.id), 4) ;
+        put(data, static_cast<std::uint32_t>(placement.level), 2) ;
+        put(data, static_cast<std::uint32_t>(placement.page), 2) ;
+        put(data, static_cast<std::uint32_t>(placement.x), 2) ;
+        put(data, static_cast<std::uint32_t>(placement.y), 2) ;
+        put(data, static_cast<std::uint32_t>(placement.size), 2) ;
+        put(data, 0, 2) ;
+    }
+    return file ;
+}
+//==============================================================================================================================
+auto AtlasBuilder::jsonTable() const -> OutputFile {
+    auto textures = table() ;
+    auto text = "{\n  \"pages\": [\n"s ;
+    for (auto number = std::size_t(0) ; number < pages.size() ; number++) {
+        const auto &page = pages[number] ;
+        text += "    {\"file\": \""s + pageName(static_cast<int>(number)) + "\", \"width\": "s + std::to_string(page.width) + ", \"height\": "s + std::to_string(page.height) + "}"s ;
+        text += (number + 1 < pages.size() ? ",\n"s : "\n"s) ;
+    }
+    text += "  ],\n  \"textures\": [\n"s ;
+    for (auto number = std::size_t(0) ; number < textures.size() ; number++) {
+        const auto &placement = textures[number] ;
+        text += "    {\"id\": "s + std::to_string(placement.id) + ", \"level\": "s + std::to_string(placement.level) + ", \"page\": "s + std::to_string(placement.page) + ", \"x\": "s + std::to_string(placement.x) + ", \"y\": "s + std::to_string(placement.y) + ", \"width\": "s + std::to_string(placement.size) + ", \"height\": "s + std::to_string(placement.size) + "}"s ;
+        text += (number + 1 < textures.size() ? ",\n"s : "\n"s) ;
+    }
+    text += "  ]\n}\n"s ;
+    return OutputFile{"atlas.json"s, FileData(text.begin(), text.end())} ;
+}
@@ -0,0 +1,103 @@
+//
+
+#ifndef atlas_hpp
+#define atlas_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "imageencoder.hpp"
+#include "outputwriter.hpp"
+
+//======================================================================
+/* Texture atlas
+ Rather than a file per texture, the textures are packed into a few large "pages" (atlas_00.bmp, atlas_01.bmp, ..., or
+ .qoi/.png, see imageencoder.hpp).
+ Textures only come in a couple of sizes, so each page only holds one size, laid out on a simple grid, left to right,
+ then top to bottom, in texture id order.  A page is at most pageSize pixels wide and high, the last page of a
+ size may be shorter (and if it has less than a row, narrower).  Unused cells are left 0 (transparent in 32 bit).
+
+ Along with the pages, a table of where each texture is placed is written, both as JSON (atlas.json) and as a
+ compact binary file (atlas.bin).  The rectangles are in image coordinates: x to the right, y down, from the top left
+ corner of the page (as a viewer shows it, not the bottom up order the BMP rows are stored in).
+ The pages are built as 0555 pixels, and only made into image files once every texture is drawn.
+
+ atlas.bin (all values little endian)
+ Offset      Size        Purpose
+ 0           4 bytes     'TXAT'
+ 4           4 bytes     Version (2)
+ 8           4 bytes     Number of pages
+ 12          4 bytes     Number of textures
+ 16          8 bytes     For each page: the width, and height (4 bytes each).  Page n is in the file atlas_nn.bmp (or .qoi/.png)
+ ...         16 bytes    For each texture (and each of its mip levels, see mipmap.hpp):
+                              4 bytes     Texture id
+                              2 bytes     Mip level (0 for the texture itself)
+                              2 bytes     Page
+                              2 bytes     x
+                              2 bytes     y
+                              2 bytes     Size (width and height)
+                              2 bytes     Unused (0)
+ Version 1 had no mip level (or unused bytes), so 12 bytes for each texture.
+ */
+
+//==============================================================================================================================
+// AtlasPlacement
+//==============================================================================================================================
+struct AtlasPlacement {
+    int id ;
+    int page ;
+    int x ;
+    int y ;
+    int size ;  // The width and height
+    int level ;  // The mip level, 0 for the texture itself
+};
+
+//==============================================================================================================================
+// AtlasBuilder
+//==============================================================================================================================
+/*
+ Use in three steps:
+    1) place each texture, in id order (this decides the layout, so it is done on one thread)
+    2) allocate the pages
+    3) draw each texture (entries) into its place.  Each placement is a different part of a page, so this can be done from
+       as many threads as one likes.
+ Then encode the finished pages (again, each page can be done on a different thread), and take the tables.
+ */
+class AtlasBuilder {
+    struct Page {
+        int cell ;  // The size of the textures on this page
+        int count ;  // The number of textures on it
+        int width ;
+        int height ;
+        std::vector<std::uint16_t> pixels ;  // Top row first
+    };
+    struct SizeClass {
+        int page ;  // The page we are currently filling
+        int next ;  // The next cell on that page
+    };
+    int pageSize ;
+    std::string extension ;
+    std::vector<Page> pages ;
+    std::vector<AtlasPlacement> placements ;
+    std::vector<AtlasPlacement> aliases ;
+    std::map<int, SizeClass> sizes ;
+public:
+    AtlasBuilder(int pageSize, const std::string &extension) ;
+    auto place(int id, int size, int level = 0) -> AtlasPlacement ;
+    // A texture with the same pixels as one already placed, shares its place (it is not drawn again)
+    auto alias(int id, const AtlasPlacement &same) -> AtlasPlacement ;
+    auto allocate() -> void ;
+    auto draw(const AtlasPlacement &placement, const std::uint16_t *pixels) -> void ;
+    auto entries() const -> const std::vector<AtlasPlacement>& ;  // Only the textures that need to be drawn
+    auto table() const -> std::vector<AtlasPlacement> ;  // Every texture (including aliases), in id (then level) order
+    auto pageCount() const -> std::size_t ;
+    auto pageName(int page) const -> std::string ;  // "atlas_nn" and the extension
+    auto encodePage(std::size_t page, const ImageEncoder &encoder) -> OutputFile ;  // Frees the page's pixels
+    auto binaryTable() const -> OutputFile ;
+    auto jsonTable() const -> OutputFile ;
+};
+
+#endif /* atlas_hpp */
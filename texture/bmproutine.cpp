@@ -3,6 +3,7 @@
 #include "bmproutine.hpp"
 
 #include <algorithm>
+#include <fstream>
 #include <stdexcept>
 
 
@@ -26,12 +27,23 @@ auto BmpHeader::save(std::ostream &output) const -> void {
     output.write(reinterpret_cast<const char*>(&dataOffset),4);
 }
 
+//==============================================================================================================================
+auto BmpHeader::load(std::istream &input) -> void {
+    input.read(reinterpret_cast<char*>(&identifer), 2);
+    input.read(reinterpret_cast<char*>(&bmpFileSize),4);
+    input.read(reinterpret_cast<char*>(applicationSpecific.data()),4);
+    input.read(reinterpret_cast<char*>(&dataOffset),4);
+    if (!input || identifer != 0x4D42) {
+        throw std::runtime_error("Not a BMP file"s);
+    }
+}
+
 //==============================================================================================================================
 // DibHeader
 //==============================================================================================================================
 //==============================================================================================================================
 // We are going to make the verticalRelation be 72DPI, which
-DibHeader::DibHeader(): dibSize(40),pixelWidth(0),pixelHeight(0),colorPlanes(1),colorDepth(0),compression(0),imageSize(0),horizontalResolution(72*39.37),verticalResolution(72*39.37),colorsInPallette(0),importantColors(0){
+DibHeader::DibHeader(): dibSize(40),pixelWidth(0),pixelHeight(0),colorPlanes(1),colorDepth(0),compression(0),imageSize(0),horizontalResolution(72*39.37),verticalResolution(72*39.37),colorsInPallette(0),importantColors(0),channelMasks{0,0,0,0},colorSpace(0){
     
 }
 //==============================================================================================================================
@@ -39,10 +51,17 @@ DibHeader::DibHeader(std::int32_t width, std::int32_t height, std::uint16_t colo
     this->colorDepth = colorDepth ;
     this->pixelWidth = width ;
     this->pixelHeight = height ;
+    if (colorDepth == 32) {
+        // We need the larger header to be able to say where the alpha is
+        this->dibSize = 108 ;
+        this->compression = 3 ; // BI_BITFIELDS
+        this->channelMasks = {0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000} ;
+        this->colorSpace = 0x73524742 ; // 'sRGB'
+    }
 }
 //==============================================================================================================================
 auto DibHeader::padBytes() const -> int {
-    return static_cast<int>((this->pixelWidth * (colorDepth>=8?colorDepth/8:1) ) % 4);
+    return static_cast<int>((4 - (this->pixelWidth * (colorDepth>=8?colorDepth/8:1) ) % 4) % 4);
 }
 //==============================================================================================================================
 auto DibHeader::save(std::ostream &output) const -> void {
@@ -57,4 +76,192 @@ auto DibHeader::save(std::ostream &output) const -> void {
     output.write(reinterpret_cast<const char*>(&verticalResolution),4);
     output.write(reinterpret_cast<const char*>(&colorsInPallette),4);
     output.write(reinterpret_cast<const char*>(&importantColors),4);
+    if (dibSize >= 108) {
+        auto zero = std::array<std::uint8_t,48>{} ; // The endpoints and gamma, which sRGB does not use
+        output.write(reinterpret_cast<const char*>(channelMasks.data()),16);
+        output.write(reinterpret_cast<const char*>(&colorSpace),4);
+        output.write(reinterpret_cast<const char*>(zero.data()),48);
+    }
+}
+
+//==============================================================================================================================
+auto DibHeader::load(std::istream &input) -> void {
+    input.read(reinterpret_cast<char*>(&dibSize), 4);
+    if (!input || dibSize < 40) {
+        throw std::runtime_error("Unsupported BMP header (size "s + std::to_string(dibSize) + ")"s);
+    }
+    input.read(reinterpret_cast<char*>(&pixelWidth),4);
+    input.read(reinterpret_cast<char*>(&pixelHeight),4);
+    input.read(reinterpret_cast<char*>(&colorPlanes),2);
+    input.read(reinterpret_cast<char*>(&colorDepth),2);
+    input.read(reinterpret_cast<char*>(&compression),4);
+    input.read(reinterpret_cast<char*>(&imageSize),4);
+    input.read(reinterpret_cast<char*>(&horizontalResolution),4);
+    input.read(reinterpret_cast<char*>(&verticalResolution),4);
+    input.read(reinterpret_cast<char*>(&colorsInPallette),4);
+    input.read(reinterpret_cast<char*>(&importantColors),4);
+    channelMasks = {0, 0, 0, 0} ;
+    colorSpace = 0 ;
+    // The red, green, and blue masks are in the same place either way: in the larger headers, or right after a
+    // BITMAPINFOHEADER (when it uses BI_BITFIELDS).  Only the larger headers have the alpha mask and the color space.
+    if (compression == 3 || dibSize >= 52) {
+        input.read(reinterpret_cast<char*>(channelMasks.data()),12);
+    }
+    if (dibSize >= 56) {
+        input.read(reinterpret_cast<char*>(&channelMasks[3]),4);
+    }
+    if (dibSize >= 108) {
+        input.read(reinterpret_cast<char*>(&colorSpace),4);
+    }
+    if (!input) {
+        throw std::runtime_error("The BMP header is cut short"s);
+    }
+}
+
+//==============================================================================================================================
+// loadBmp
+//==============================================================================================================================
+//==============================================================================================================================
+namespace {
+    //==========================================================================================================================
+    // Cut an 8 bit value down to 5 bits (the reverse of expanding it, so exported colors come back exactly)
+    inline auto reduce8(std::uint8_t value) -> std::uint16_t {
+        return static_cast<std::uint16_t>(value >> 3) ;
+    }
+    //==========================================================================================================================
+    auto packRow(const std::uint8_t *row, int width, int depth, bool alpha, std::uint16_t *pixels) -> void {
+        auto bytesPerPixel = depth / 8 ;
+        for (auto x = 0 ; x < width ; x++) {
+            const auto *pixel = row + static_cast<std::size_t>(x) * static_cast<std::size_t>(bytesPerPixel) ;
+            if (depth == 16) {
+                pixels[x] = static_cast<std::uint16_t>(pixel[0] | (pixel[1] << 8)) ;
+            }
+            else if (alpha && pixel[3] == 0) {
+                pixels[x] = 0 ;  // Transparent is "no color"
+            }
+            else {
+                pixels[x] = static_cast<std::uint16_t>((reduce8(pixel[2]) << 10) | (reduce8(pixel[1]) << 5) | reduce8(pixel[0])) ;
+            }
+        }
+    }
+    //==========================================================================================================================
+    // Work out if we understand the layout of the pixels, and if it has alpha (throws if we do not)
+    auto checkLayout(const DibHeader &dib) -> bool {
+        if (dib.colorPlanes != 1 || dib.colorsInPallette != 0 || (dib.colorDepth != 16 && dib.colorDepth != 24 && dib.colorDepth != 32)) {
+            throw std::runtime_error("Unsupported BMP color depth: "s + std::to_string(dib.colorDepth) + " (must be 16, 24, or 32 bits, with no palette)"s);
+        }
+        if (dib.compression == 0) {
+            return false ;  // No masks, so the 4th byte of a 32 bit pixel is not alpha (many programs leave it 0)
+        }
+        auto masks = dib.channelMasks ;
+        auto understood = false ;
+        if (dib.compression == 3 && dib.colorDepth == 16) {
+            understood = (masks[0] == 0x7C00 && masks[1] == 0x03E0 && masks[2] == 0x001F) ;
+        }
+        else if (dib.compression == 3 && dib.colorDepth == 32) {
+            understood = (masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 && masks[2] == 0x000000FF && (masks[3] == 0 || masks[3] == 0xFF000000)) ;
+        }
+        if (!understood) {
+            throw std::runtime_error("Unsupported BMP compression or channel masks for "s + std::to_string(dib.colorDepth) + " bit color"s);
+        }
+        return masks[3] == 0xFF000000 ;
+    }
+}
+//==============================================================================================================================
+auto loadBmp(const std::filesystem::path &path) -> BmpImage {
+    auto input = std::ifstream(path.string(), std::ios::binary) ;
+    if (!input.is_open()) {
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    try {
+        auto bmp = BmpHeader() ;
+        bmp.load(input);
+        auto dib = DibHeader() ;
+        dib.load(input);
+        auto alpha = checkLayout(dib) ;
+        auto topDown = dib.pixelHeight < 0 ;
+        auto image = BmpImage{dib.pixelWidth, topDown ? -dib.pixelHeight : dib.pixelHeight, {}} ;
+        if (image.width <= 0 || image.height <= 0 || image.width > 32768 || image.height > 32768) {
+            throw std::runtime_error("Unsupported image size: "s + std::to_string(image.width) + "x"s + std::to_string(image.height));
+        }
+        auto rowBytes = static_cast<std::size_t>(image.width) * static_cast<std::size_t>(dib.colorDepth / 8) ;
+        auto stride = rowBytes + ((4 - rowBytes % 4) % 4) ;
+        auto data = std::vector<std::uint8_t>(stride * static_cast<std::size_t>(image.height)) ;
+        input.seekg(bmp.dataOffset);
+        input.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!input) {
+            throw std::runtime_error("The pixel data is cut short"s);
+        }
+        // The rows are usually stored bottom row first, so they are flipped back as they are converted
+        image.pixels.resize(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height)) ;
+        for (auto line = 0 ; line < image.height ; line++) {
+            auto stored = static_cast<std::size_t>(topDown ? line : image.height - 1 - line) ;
+            packRow(data.data() + stored * stride, image.width, dib.colorDepth, alpha, image.pixels.data() + static_cast<std::size_t>(line) * static_cast<std::size_t>(image.width));
+        }
+        return image ;
+    }
+    catch(const std::exception &e) {
+        throw std::runtime_error(path.string() + ": "s + e.what());
+    }
+}
+
+//==============================================================================================================================
+// BmpEncoder
+//==============================================================================================================================
+//==============================================================================================================================
+namespace {
+    template <int Width>
+    auto encodeBmpDepth(const std::uint16_t *pixels, int depth) -> FileData {
+        switch (depth) {
+            case 16:
+                return BmpEncoder<Width,16>::encode(pixels) ;
+            case 24:
+                return BmpEncoder<Width,24>::encode(pixels) ;
+            case 32:
+                return BmpEncoder<Width,32>::encode(pixels) ;
+            default:
+                throw std::runtime_error("Unsupported color depth: "s + std::to_string(depth));
+        }
+    }
+}
+//==============================================================================================================================
+auto encodeBmp(const std::uint16_t *pixels, int width, int depth) -> FileData {
+    switch (width) {
+        case 64:
+            return encodeBmpDepth<64>(pixels, depth) ;
+        case 128:
+            return encodeBmpDepth<128>(pixels, depth) ;
+        default:
+            throw std::runtime_error("Unsupported texture width: "s + std::to_string(width));
+    }
+}
+//==============================================================================================================================
+auto encodeBmp(const std::uint16_t *pixels, int width, int height, int depth) -> FileData {
+    if (width == height && (width == 64 || width == 128)) {
+        return encodeBmp(pixels, width, depth) ;
+    }
+    if (depth != 16 && depth != 24 && depth != 32) {
+        throw std::runtime_error("Unsupported color depth: "s + std::to_string(depth));
+    }
+    auto rowBytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(depth / 8) ;
+    auto stride = rowBytes + ((4 - rowBytes % 4) % 4) ;
+    auto dataOffset = bmpHeaderSize(static_cast<std::uint16_t>(depth)) ;
+    // Zero filled, so the pad bytes are already 0
+    auto buffer = FileData(dataOffset + stride * static_cast<std::size_t>(height), 0) ;
+    writeBmpHeaders(buffer.data(), width, height, static_cast<std::uint16_t>(depth)) ;
+    convertRows(pixels, width, height, depth, buffer.data() + dataOffset, stride) ;
+    return buffer ;
+}
+//==============================================================================================================================
+auto saveFile(const std::filesystem::path &path, const FileData &contents) -> void {
+    auto output = std::ofstream(path.string(),std::ios::binary) ;
+    if (!output.is_open()) {
+        throw std::runtime_error("Unable to create: "s + path.string());
+    }
+    output.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size())) ;
+    // The data may only reach the disk (and fail to) when the file is closed, so we close it ourselves to check
+    output.close();
+    if (output.fail()) {
+        throw std::runtime_error("Unable to write: "s + path.string());
+    }
 }
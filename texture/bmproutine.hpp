@@ -5,8 +5,15 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <istream>
 #include <ostream>
 #include <string>
+#include <vector>
+
+#include "colorconvert.hpp"
+#include "filedata.hpp"
 
 //======================================================================
 /* BMP file
@@ -61,6 +68,7 @@ struct BmpHeader {
     std::array<std::uint16_t,2> applicationSpecific ;
     std::uint32_t dataOffset ;
     auto save(std::ostream &output) const -> void ;
+    auto load(std::istream &input) -> void ;  // Throws if it is not a BMP file
     BmpHeader() ;
 };
 //==============================================================================================================================
@@ -81,6 +89,16 @@ struct BmpHeader {
  42                  4               the vertical resolution of the image. (pixel per metre, signed integer)
  46                  4               the number of colors in the color palette, or 0 to default to 2n
  50                  4               the number of important colors used, or 0 when every color is important; generally ignored
+
+ For 32 bit color, we use the larger BITMAPV4HEADER (108 bytes), which follows the above with the following.
+ It lets us say the 4th byte of each pixel is alpha (many programs ignore the 4th byte of a plain 32 bit BMP).
+ 54                  4               the red channel bit mask (with compression set to 3, BI_BITFIELDS)
+ 58                  4               the green channel bit mask
+ 62                  4               the blue channel bit mask
+ 66                  4               the alpha channel bit mask
+ 70                  4               the color space type ('sRGB')
+ 74                  36              the color space endpoints (unused for sRGB)
+ 110                 12              the red, green, and blue gamma (unused for sRGB)
   
 
  */
@@ -96,10 +114,143 @@ struct DibHeader {
     std::uint32_t verticalResolution ;
     std::uint32_t colorsInPallette ;
     std::uint32_t importantColors ;
+    std::array<std::uint32_t,4> channelMasks ;  // red, green, blue, alpha (BITMAPV4HEADER only)
+    std::uint32_t colorSpace ;  // (BITMAPV4HEADER only)
     auto save(std::ostream &output) const -> void ;
+    // Reads a BITMAPINFOHEADER or any of the larger ones (only the fields above), and the channel masks that follow a
+    // BITMAPINFOHEADER with BI_BITFIELDS.  Throws for the older OS/2 headers.
+    auto load(std::istream &input) -> void ;
     DibHeader() ;
     DibHeader(std::int32_t width, std::int32_t height, std::uint16_t colorDepth = 16);
     auto padBytes() const -> int ;
 };
 
+//==============================================================================================================================
+// bmpHeaderSize, writeBmpHeaders, bmpHeaderBytes
+//==============================================================================================================================
+/*
+ The BmpHeader and DibHeader above, laid out as the bytes they are saved as (all values little endian).
+ These are constexpr, so for a size we know at compile time, the headers are built by the compiler, not at run time.
+ The values are the same the two structures (and their save) produce.
+ */
+constexpr auto bmpHeaderSize(std::uint16_t colorDepth) -> std::size_t {
+    return 14 + (colorDepth == 32 ? 108 : 40) ;
+}
+//==============================================================================================================================
+// Write the headers to the buffer (which must be at least bmpHeaderSize bytes), and return the number of bytes written
+constexpr auto writeBmpHeaders(std::uint8_t *buffer, std::int32_t width, std::int32_t height, std::uint16_t colorDepth) -> std::size_t {
+    auto put = [buffer](int offset, std::uint32_t value, int size) {
+        for (auto i = 0 ; i < size ; i++) {
+            buffer[offset + i] = static_cast<std::uint8_t>((value >> (8*i)) & 0xFF) ;
+        }
+    };
+    auto headerSize = static_cast<std::uint32_t>(bmpHeaderSize(colorDepth)) ;
+    auto bytesPerPixel = static_cast<std::uint32_t>(colorDepth>=8?colorDepth/8:1) ;
+    auto rowBytes = static_cast<std::uint32_t>(width) * bytesPerPixel ;
+    auto stride = rowBytes + ((4 - rowBytes % 4) % 4) ; // Each row is padded to a multiple of 4 bytes
+    // BmpHeader
+    put(0, 0x4D42, 2) ;  // 'B''M'
+    put(2, headerSize + stride * static_cast<std::uint32_t>(height), 4) ;  // bmpFileSize
+    put(6, 0, 4) ;  // applicationSpecific
+    put(10, headerSize, 4) ;  // dataOffset
+    // DibHeader
+    put(14, headerSize - 14, 4) ;  // dibSize
+    put(18, static_cast<std::uint32_t>(width), 4) ;
+    put(22, static_cast<std::uint32_t>(height), 4) ;
+    put(26, 1, 2) ;  // colorPlanes
+    put(28, colorDepth, 2) ;
+    put(30, (colorDepth == 32 ? 3 : 0), 4) ;  // compression
+    put(34, 0, 4) ;  // imageSize
+    put(38, static_cast<std::uint32_t>(72*39.37), 4) ;  // horizontalResolution
+    put(42, static_cast<std::uint32_t>(72*39.37), 4) ;  // verticalResolution
+    put(46, 0, 4) ;  // colorsInPallette
+    put(50, 0, 4) ;  // importantColors
+    if (colorDepth == 32) {
+        put(54, 0x00FF0000, 4) ;  // redMask
+        put(58, 0x0000FF00, 4) ;  // greenMask
+        put(62, 0x000000FF, 4) ;  // blueMask
+        put(66, 0xFF000000, 4) ;  // alphaMask
+        put(70, 0x73524742, 4) ;  // colorSpace 'sRGB'
+        for (auto offset = 74 ; offset < 122 ; offset += 4) {
+            put(offset, 0, 4) ;  // endpoints and gamma, unused for sRGB
+        }
+    }
+    return headerSize ;
+}
+//==============================================================================================================================
+template <std::int32_t Width, std::int32_t Height, std::uint16_t Depth>
+constexpr auto bmpHeaderBytes() -> std::array<std::uint8_t,bmpHeaderSize(Depth)> {
+    auto bytes = std::array<std::uint8_t,bmpHeaderSize(Depth)>{} ;
+    writeBmpHeaders(bytes.data(), Width, Height, Depth) ;
+    return bytes ;
+}
+
+//==============================================================================================================================
+// BmpEncoder
+//==============================================================================================================================
+/*
+ Encodes a square texture of 0555 color words (top row first, as they are in texmaps.mul) to a complete BMP file,
+ in one contiguous buffer: the header (built at compile time), then the rows bottom row first, with any pad bytes.
+ Since the buffer is the whole file, it can be written with a single write.
+ Textures only come in a few sizes, so we make one encoder for each, and the sizes all become constants.
+ The depth can be 16 (the texture data as is), 24 or 32 (see colorconvert.hpp).
+ */
+template <int Width, int Depth = 16>
+struct BmpEncoder {
+    static_assert(Width > 0, "A BMP must have at least one pixel per row") ;
+    static_assert(Depth == 16 || Depth == 24 || Depth == 32, "The color depth must be 16, 24, or 32 bits") ;
+    static constexpr auto bytesPerPixel = Depth / 8 ;
+    static constexpr auto rowBytes = Width * bytesPerPixel ;
+    static constexpr auto padBytes = (4 - rowBytes % 4) % 4 ;
+    static constexpr auto stride = rowBytes + padBytes ;
+    static constexpr auto header = bmpHeaderBytes<Width, Width, Depth>() ;
+    static constexpr auto dataOffset = header.size() ;
+    static constexpr auto fileSize = dataOffset + static_cast<std::size_t>(stride) * Width ;
+
+    // The buffer must be at least fileSize bytes
+    static auto encode(const std::uint16_t *pixels, std::uint8_t *buffer) -> void {
+        std::memcpy(buffer, header.data(), header.size()) ;
+        // Convert (if needed) and flip the rows in one pass
+        convertRows(pixels, Width, Width, Depth, buffer + dataOffset, stride) ;
+        if constexpr (padBytes > 0) {
+            for (auto line = 0 ; line < Width ; line++) {
+                std::memset(buffer + dataOffset + static_cast<std::size_t>(line) * stride + rowBytes, 0, padBytes) ;
+            }
+        }
+    }
+    // Every byte is written by encode, so the buffer is not zero filled first (see filedata.hpp)
+    static auto encode(const std::uint16_t *pixels) -> FileData {
+        auto buffer = FileData(fileSize) ;
+        encode(pixels, buffer.data()) ;
+        return buffer ;
+    }
+};
+
+// Encode a texture of the given width (64 or 128) and depth with the matching BmpEncoder.  Throws for anything else.
+auto encodeBmp(const std::uint16_t *pixels, int width, int depth = 16) -> FileData ;
+// Encode an image of any size the same way, with the sizes worked out at run time (a square 64 or 128 uses the BmpEncoder)
+auto encodeBmp(const std::uint16_t *pixels, int width, int height, int depth) -> FileData ;
+//==============================================================================================================================
+// loadBmp
+//==============================================================================================================================
+/*
+ Reads a BMP file back into 0555 color words, top row first (the layout of texmaps.mul), the reverse of encodeBmp.
+ It takes the layouts we write, as an image editor is likely to save them again:
+    16 bit      0555 words (uncompressed, or BI_BITFIELDS with the 0555 masks), kept exactly as they are
+    24 bit      blue, green, red bytes, each cut down to 5 bits
+    32 bit      blue, green, red, and (if the header has an alpha mask) alpha.  A pixel with alpha 0 becomes 0x0000 ("no
+                color"), whatever its color
+ Rows may be stored bottom up (the usual) or top down (a negative height).  Anything else (palettes, compression,
+ other masks) throws, saying what it was.
+ */
+struct BmpImage {
+    int width ;
+    int height ;
+    std::vector<std::uint16_t> pixels ;  // width * height 0555 color words, top row first
+};
+auto loadBmp(const std::filesystem::path &path) -> BmpImage ;
+
+// Save a complete file from a buffer, with one write.  Throws if the file can not be created or written
+auto saveFile(const std::filesystem::path &path, const FileData &contents) -> void ;
+
 #endif /* bmproutine_hpp */
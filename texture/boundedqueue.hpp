@@ -0,0 +1,85 @@
+//
+
+#ifndef boundedqueue_hpp
+#define boundedqueue_hpp
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+//==============================================================================================================================
+// BoundedQueue
+//==============================================================================================================================
+/*
+ A first in, first out queue that can be shared between threads, that holds at most "capacity" items.
+ A producer that pushes onto a full queue waits until a consumer pops something off, which is what keeps
+ the memory used by a pipeline capped, no matter how much faster the producers are than the consumer.
+ Once closed, push is ignored (returns false), and pop returns false once the queue has been emptied.
+ */
+template <typename T>
+class BoundedQueue {
+    std::deque<T> items ;
+    std::size_t capacity ;
+    bool closed ;
+    mutable std::mutex access ;
+    std::condition_variable notFull ;
+    std::condition_variable notEmpty ;
+public:
+    explicit BoundedQueue(std::size_t capacity):capacity(capacity>0?capacity:1),closed(false) {}
+    //==========================================================================================================================
+    auto push(T &&item) -> bool {
+        auto lock = std::unique_lock<std::mutex>(access) ;
+        notFull.wait(lock, [this]{ return closed || items.size() < capacity ;});
+        if (closed) {
+            return false ;
+        }
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true ;
+    }
+    //==========================================================================================================================
+    auto pop(T &item) -> bool {
+        auto lock = std::unique_lock<std::mutex>(access) ;
+        notEmpty.wait(lock, [this]{ return closed || !items.empty() ;});
+        if (items.empty()) {
+            return false ;  // We are closed, and there is nothing left
+        }
+        item = std::move(items.front()) ;
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true ;
+    }
+    //==========================================================================================================================
+    // Like pop, but if there is nothing there right now, returns false rather than waiting
+    auto tryPop(T &item) -> bool {
+        auto lock = std::unique_lock<std::mutex>(access) ;
+        if (items.empty()) {
+            return false ;
+        }
+        item = std::move(items.front()) ;
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true ;
+    }
+    //==========================================================================================================================
+    auto close() -> void {
+        {
+            auto lock = std::lock_guard<std::mutex>(access) ;
+            closed = true ;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+    //==========================================================================================================================
+    auto size() const -> std::size_t {
+        auto lock = std::lock_guard<std::mutex>(access) ;
+        return items.size() ;
+    }
+};
+
+#endif /* boundedqueue_hpp */
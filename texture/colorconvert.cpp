@@ -0,0 +1,429 @@
+//
+
+#include "colorconvert.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// The vector routines are compiled for their instruction set, even if the rest of the program is not.
+// Visual Studio does not need this, it allows any instruction set's intrinsics anywhere.
+#if defined(TEXTURE_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+#define TEXTURE_TARGET_SSE2 __attribute__((target("sse2")))
+#define TEXTURE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TEXTURE_TARGET_SSE2
+#define TEXTURE_TARGET_AVX2
+#endif
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    // The scalar (reference) conversion
+    //==========================================================================================================================
+    // Expand a 5 bit value to 8 bits
+    inline auto expand5(std::uint32_t value) -> std::uint8_t {
+        return static_cast<std::uint8_t>((value << 3) | (value >> 2)) ;
+    }
+    //==========================================================================================================================
+    // With Rgb, the red and blue bytes swap places (the order PNG and QOI want)
+    template <bool Rgb>
+    auto scalarRow24(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        for (auto i = 0 ; i < count ; i++) {
+            auto color = static_cast<std::uint32_t>(pixels[i]) ;
+            output[Rgb ? 2 : 0] = expand5(color & 0x1F) ;          // Blue
+            output[1] = expand5((color >> 5) & 0x1F) ;             // Green
+            output[Rgb ? 0 : 2] = expand5((color >> 10) & 0x1F) ;  // Red
+            output += 3 ;
+        }
+    }
+    //==========================================================================================================================
+    template <bool Rgb>
+    auto scalarRow32(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        for (auto i = 0 ; i < count ; i++) {
+            auto color = static_cast<std::uint32_t>(pixels[i]) ;
+            output[Rgb ? 2 : 0] = expand5(color & 0x1F) ;          // Blue
+            output[1] = expand5((color >> 5) & 0x1F) ;             // Green
+            output[Rgb ? 0 : 2] = expand5((color >> 10) & 0x1F) ;  // Red
+            output[3] = ((color & 0x7FFF) == 0 ? 0 : 0xFF) ;  // Alpha, "no color" is transparent
+            output += 4 ;
+        }
+    }
+    //==========================================================================================================================
+    // Average a 2x2 block of 0555 pixels, channel by channel (rounded to the nearest).  "No color" pixels are left out of
+    // the average, so they do not darken the edges of a shape.  A block of nothing but "no color" stays "no color", and
+    // an average of colors that comes out as 0 (which would read as "no color") becomes the darkest gray (0x0421).
+    inline auto averageBlock(const std::uint16_t *top, const std::uint16_t *bottom) -> std::uint16_t {
+        auto blue = 0u ;
+        auto green = 0u ;
+        auto red = 0u ;
+        auto count = 0u ;
+        for (auto color : {top[0], top[1], bottom[0], bottom[1]}) {
+            if ((color & 0x7FFF) != 0) {
+                blue += color & 0x1F ;
+                green += (color >> 5) & 0x1F ;
+                red += (color >> 10) & 0x1F ;
+                count++ ;
+            }
+        }
+        if (count == 0) {
+            return 0 ;
+        }
+        auto result = static_cast<std::uint16_t>((((red + count / 2) / count) << 10) | (((green + count / 2) / count) << 5) | ((blue + count / 2) / count)) ;
+        return (result == 0 ? 0x0421 : result) ;
+    }
+    //==========================================================================================================================
+    // One output row from two input rows ("count" output pixels)
+    auto scalarHalveRow(const std::uint16_t *top, const std::uint16_t *bottom, int count, std::uint16_t *output) -> void {
+        for (auto i = 0 ; i < count ; i++) {
+            output[i] = averageBlock(top + 2 * i, bottom + 2 * i) ;
+        }
+    }
+
+#if defined(TEXTURE_HAVE_X86_KERNELS)
+    //==========================================================================================================================
+    // SSE2, 8 pixels at a time
+    //==========================================================================================================================
+    // Expand the 5 bit channels of 8 pixels, and pair them up as 16 bit values (blue | green << 8) and (red | alpha << 8).
+    // Interleaving those two gives the 32 bit BGRA pixels (or RGBA, if we swap red and blue)
+    template <bool Rgb>
+    TEXTURE_TARGET_SSE2 inline auto sse2Pixels(const std::uint16_t *pixels, __m128i &low, __m128i &high) -> void {
+        const auto mask5 = _mm_set1_epi16(0x1F) ;
+        auto color = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)) ;
+        auto blue = _mm_and_si128(color, mask5) ;
+        auto green = _mm_and_si128(_mm_srli_epi16(color, 5), mask5) ;
+        auto red = _mm_and_si128(_mm_srli_epi16(color, 10), mask5) ;
+        blue = _mm_or_si128(_mm_slli_epi16(blue, 3), _mm_srli_epi16(blue, 2)) ;
+        green = _mm_or_si128(_mm_slli_epi16(green, 3), _mm_srli_epi16(green, 2)) ;
+        red = _mm_or_si128(_mm_slli_epi16(red, 3), _mm_srli_epi16(red, 2)) ;
+        auto transparent = _mm_cmpeq_epi16(_mm_and_si128(color, _mm_set1_epi16(0x7FFF)), _mm_setzero_si128()) ;
+        auto alpha = _mm_andnot_si128(transparent, _mm_set1_epi16(0xFF)) ;
+        auto bluegreen = _mm_or_si128(Rgb ? red : blue, _mm_slli_epi16(green, 8)) ;
+        auto redalpha = _mm_or_si128(Rgb ? blue : red, _mm_slli_epi16(alpha, 8)) ;
+        low = _mm_unpacklo_epi16(bluegreen, redalpha) ;
+        high = _mm_unpackhi_epi16(bluegreen, redalpha) ;
+    }
+    //==========================================================================================================================
+    // Take 4 BGRA pixels, and pack them into the first 12 bytes as BGR
+    TEXTURE_TARGET_SSE2 inline auto sse2Pack24(__m128i pixels) -> __m128i {
+        // Drop the alpha, and then in each 64 bit half, move the upper pixel down next to the lower one (6 bytes each half)
+        auto rgb = _mm_and_si128(pixels, _mm_set1_epi32(0x00FFFFFF)) ;
+        auto halves = _mm_or_si128(_mm_and_si128(rgb, _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF)), _mm_slli_epi64(_mm_srli_epi64(rgb, 32), 24)) ;
+        // Now slide the upper half down 2 bytes, so it sits right after the lower half
+        auto lower = _mm_and_si128(halves, _mm_set_epi32(0, 0, 0x0000FFFF, static_cast<int>(0xFFFFFFFF))) ;
+        auto upper = _mm_and_si128(_mm_srli_si128(halves, 2), _mm_set_epi32(0, static_cast<int>(0xFFFFFFFF), static_cast<int>(0xFFFF0000), 0)) ;
+        return _mm_or_si128(lower, upper) ;
+    }
+    //==========================================================================================================================
+    template <bool Rgb>
+    TEXTURE_TARGET_SSE2 auto sse2Row24(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        auto i = 0 ;
+        for ( ; i + 8 <= count ; i += 8) {
+            auto low = __m128i() ;
+            auto high = __m128i() ;
+            sse2Pixels<Rgb>(pixels + i, low, high) ;
+            auto first = sse2Pack24(low) ;   // 12 bytes
+            auto second = sse2Pack24(high) ; // 12 bytes
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_or_si128(first, _mm_slli_si128(second, 12))) ;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 16), _mm_srli_si128(second, 4)) ;
+            output += 24 ;
+        }
+        scalarRow24<Rgb>(pixels + i, count - i, output) ;
+    }
+    //==========================================================================================================================
+    template <bool Rgb>
+    TEXTURE_TARGET_SSE2 auto sse2Row32(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        auto i = 0 ;
+        for ( ; i + 8 <= count ; i += 8) {
+            auto low = __m128i() ;
+            auto high = __m128i() ;
+            sse2Pixels<Rgb>(pixels + i, low, high) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), low) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16), high) ;
+            output += 32 ;
+        }
+        scalarRow32<Rgb>(pixels + i, count - i, output) ;
+    }
+
+    //==========================================================================================================================
+    // For 16 pixels (8 from first, 8 from second), the sums of each pair of neighbours (the 2 pixels of one row of a block)
+    // of a channel, and of how many of them have a color.  _mm_madd_epi16 with 1s adds each pair of 16 bit lanes.
+    TEXTURE_TARGET_SSE2 inline auto sse2PairSums(__m128i first, __m128i second, __m128i &blue, __m128i &green, __m128i &red, __m128i &count) -> void {
+        const auto mask5 = _mm_set1_epi16(0x1F) ;
+        const auto ones = _mm_set1_epi16(1) ;
+        auto pairs = [](__m128i low, __m128i high, __m128i ones) {
+            return _mm_packs_epi32(_mm_madd_epi16(low, ones), _mm_madd_epi16(high, ones)) ;
+        };
+        blue = pairs(_mm_and_si128(first, mask5), _mm_and_si128(second, mask5), ones) ;
+        green = pairs(_mm_and_si128(_mm_srli_epi16(first, 5), mask5), _mm_and_si128(_mm_srli_epi16(second, 5), mask5), ones) ;
+        red = pairs(_mm_and_si128(_mm_srli_epi16(first, 10), mask5), _mm_and_si128(_mm_srli_epi16(second, 10), mask5), ones) ;
+        const auto colorMask = _mm_set1_epi16(0x7FFF) ;
+        auto firstColored = _mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(first, colorMask), _mm_setzero_si128()), ones) ;
+        auto secondColored = _mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(second, colorMask), _mm_setzero_si128()), ones) ;
+        count = pairs(firstColored, secondColored, ones) ;
+    }
+    //==========================================================================================================================
+    // The same as scalarHalveRow, 8 output pixels at a time.  The division by the number of colored pixels (1-4) is done
+    // by multiplying by 512/count and shifting right 9 (512/3 is rounded up to 171, which still gives the exact result
+    // for every sum we can have, 0-126).
+    TEXTURE_TARGET_SSE2 auto sse2HalveRow(const std::uint16_t *top, const std::uint16_t *bottom, int count, std::uint16_t *output) -> void {
+        auto i = 0 ;
+        for ( ; i + 8 <= count ; i += 8) {
+            auto blue = __m128i() ;
+            auto green = __m128i() ;
+            auto red = __m128i() ;
+            auto colored = __m128i() ;
+            sse2PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * i + 8)), blue, green, red, colored) ;
+            auto blueBelow = __m128i() ;
+            auto greenBelow = __m128i() ;
+            auto redBelow = __m128i() ;
+            auto coloredBelow = __m128i() ;
+            sse2PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * i + 8)), blueBelow, greenBelow, redBelow, coloredBelow) ;
+            blue = _mm_add_epi16(blue, blueBelow) ;
+            green = _mm_add_epi16(green, greenBelow) ;
+            red = _mm_add_epi16(red, redBelow) ;
+            colored = _mm_add_epi16(colored, coloredBelow) ;
+            // 512 / count (0 for no color, which gives 0 for every channel)
+            auto multiplier = _mm_and_si128(_mm_cmpeq_epi16(colored, _mm_set1_epi16(1)), _mm_set1_epi16(512)) ;
+            multiplier = _mm_or_si128(multiplier, _mm_and_si128(_mm_cmpeq_epi16(colored, _mm_set1_epi16(2)), _mm_set1_epi16(256))) ;
+            multiplier = _mm_or_si128(multiplier, _mm_and_si128(_mm_cmpeq_epi16(colored, _mm_set1_epi16(3)), _mm_set1_epi16(171))) ;
+            multiplier = _mm_or_si128(multiplier, _mm_and_si128(_mm_cmpeq_epi16(colored, _mm_set1_epi16(4)), _mm_set1_epi16(128))) ;
+            auto half = _mm_srli_epi16(colored, 1) ;
+            blue = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(blue, half), multiplier), 9) ;
+            green = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(green, half), multiplier), 9) ;
+            red = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(red, half), multiplier), 9) ;
+            auto result = _mm_or_si128(_mm_or_si128(blue, _mm_slli_epi16(green, 5)), _mm_slli_epi16(red, 10)) ;
+            // A colored block that averaged to 0 becomes 0x0421
+            auto black = _mm_andnot_si128(_mm_cmpeq_epi16(colored, _mm_setzero_si128()), _mm_cmpeq_epi16(result, _mm_setzero_si128())) ;
+            result = _mm_or_si128(result, _mm_and_si128(black, _mm_set1_epi16(0x0421))) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), result) ;
+        }
+        scalarHalveRow(top + 2 * i, bottom + 2 * i, count - i, output + i) ;
+    }
+
+    //==========================================================================================================================
+    // AVX2, 16 pixels at a time
+    //==========================================================================================================================
+    // The same as sse2Pixels, for 16 pixels.  The AVX2 unpack works on each 128 bit half separately, so we swap
+    // the halves around afterwards to get the pixels back in order (first = pixels 0-7, second = pixels 8-15)
+    template <bool Rgb>
+    TEXTURE_TARGET_AVX2 inline auto avx2Pixels(const std::uint16_t *pixels, __m256i &first, __m256i &second) -> void {
+        const auto mask5 = _mm256_set1_epi16(0x1F) ;
+        auto color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels)) ;
+        auto blue = _mm256_and_si256(color, mask5) ;
+        auto green = _mm256_and_si256(_mm256_srli_epi16(color, 5), mask5) ;
+        auto red = _mm256_and_si256(_mm256_srli_epi16(color, 10), mask5) ;
+        blue = _mm256_or_si256(_mm256_slli_epi16(blue, 3), _mm256_srli_epi16(blue, 2)) ;
+        green = _mm256_or_si256(_mm256_slli_epi16(green, 3), _mm256_srli_epi16(green, 2)) ;
+        red = _mm256_or_si256(_mm256_slli_epi16(red, 3), _mm256_srli_epi16(red, 2)) ;
+        auto transparent = _mm256_cmpeq_epi16(_mm256_and_si256(color, _mm256_set1_epi16(0x7FFF)), _mm256_setzero_si256()) ;
+        auto alpha = _mm256_andnot_si256(transparent, _mm256_set1_epi16(0xFF)) ;
+        auto bluegreen = _mm256_or_si256(Rgb ? red : blue, _mm256_slli_epi16(green, 8)) ;
+        auto redalpha = _mm256_or_si256(Rgb ? blue : red, _mm256_slli_epi16(alpha, 8)) ;
+        auto low = _mm256_unpacklo_epi16(bluegreen, redalpha) ;   // pixels 0-3 and 8-11
+        auto high = _mm256_unpackhi_epi16(bluegreen, redalpha) ;  // pixels 4-7 and 12-15
+        first = _mm256_permute2x128_si256(low, high, 0x20) ;
+        second = _mm256_permute2x128_si256(low, high, 0x31) ;
+    }
+    //==========================================================================================================================
+    template <bool Rgb>
+    TEXTURE_TARGET_AVX2 auto avx2Row24(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        // Moves the BGR of the 4 pixels in each 128 bit half into its first 12 bytes
+        const auto pack = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1, 0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1) ;
+        auto i = 0 ;
+        for ( ; i + 16 <= count ; i += 16) {
+            auto first = __m256i() ;
+            auto second = __m256i() ;
+            avx2Pixels<Rgb>(pixels + i, first, second) ;
+            first = _mm256_shuffle_epi8(first, pack) ;
+            second = _mm256_shuffle_epi8(second, pack) ;
+            // Four groups of 12 bytes, which we join into three 16 byte stores
+            auto a = _mm256_castsi256_si128(first) ;
+            auto b = _mm256_extracti128_si256(first, 1) ;
+            auto c = _mm256_castsi256_si128(second) ;
+            auto d = _mm256_extracti128_si256(second, 1) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_or_si128(a, _mm_slli_si128(b, 12))) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8))) ;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4))) ;
+            output += 48 ;
+        }
+        scalarRow24<Rgb>(pixels + i, count - i, output) ;
+    }
+    //==========================================================================================================================
+    template <bool Rgb>
+    TEXTURE_TARGET_AVX2 auto avx2Row32(const std::uint16_t *pixels, int count, std::uint8_t *output) -> void {
+        auto i = 0 ;
+        for ( ; i + 16 <= count ; i += 16) {
+            auto first = __m256i() ;
+            auto second = __m256i() ;
+            avx2Pixels<Rgb>(pixels + i, first, second) ;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), first) ;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 32), second) ;
+            output += 64 ;
+        }
+        scalarRow32<Rgb>(pixels + i, count - i, output) ;
+    }
+
+    //==========================================================================================================================
+    // What does the processor support
+    //==========================================================================================================================
+    auto cpuHasAvx2() -> bool {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] ;
+        __cpuid(info, 0) ;
+        if (info[0] < 7) {
+            return false ;
+        }
+        __cpuid(info, 1) ;
+        // The processor must support xsave, and the operating system must be saving the AVX registers for us
+        auto osxsave = (info[2] & (1 << 27)) != 0 ;
+        auto avx = (info[2] & (1 << 28)) != 0 ;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false ;
+        }
+        __cpuidex(info, 7, 0) ;
+        return (info[1] & (1 << 5)) != 0 ;
+#else
+        return __builtin_cpu_supports("avx2") ;
+#endif
+    }
+#endif
+
+    //==========================================================================================================================
+    using RowFunction = void (*)(const std::uint16_t *pixels, int count, std::uint8_t *output) ;
+    template <bool Rgb>
+    auto rowFunction(ColorKernel kernel, int depth) -> RowFunction {
+        switch (kernel) {
+#if defined(TEXTURE_HAVE_X86_KERNELS)
+            case ColorKernel::avx2:
+                return depth == 24 ? avx2Row24<Rgb> : avx2Row32<Rgb> ;
+            case ColorKernel::sse2:
+                return depth == 24 ? sse2Row24<Rgb> : sse2Row32<Rgb> ;
+#endif
+            default:
+                return depth == 24 ? scalarRow24<Rgb> : scalarRow32<Rgb> ;
+        }
+    }
+    //==========================================================================================================================
+    auto rowFunction(ColorKernel kernel, int depth, ChannelOrder order) -> RowFunction {
+        if (!colorKernelAvailable(kernel)) {
+            throw std::runtime_error("Color kernel not available: "s + colorKernelName(kernel));
+        }
+        if (depth != 24 && depth != 32) {
+            throw std::runtime_error("Unsupported color depth: "s + std::to_string(depth));
+        }
+        return order == ChannelOrder::rgb ? rowFunction<true>(kernel, depth) : rowFunction<false>(kernel, depth) ;
+    }
+}
+
+//==============================================================================================================================
+// ColorKernel
+//==============================================================================================================================
+//==============================================================================================================================
+auto colorKernelName(ColorKernel kernel) -> const char* {
+    switch (kernel) {
+        case ColorKernel::avx2:
+            return "avx2" ;
+        case ColorKernel::sse2:
+            return "sse2" ;
+        default:
+            return "scalar" ;
+    }
+}
+//==============================================================================================================================
+auto colorKernelAvailable(ColorKernel kernel) -> bool {
+    switch (kernel) {
+#if defined(TEXTURE_HAVE_X86_KERNELS)
+        case ColorKernel::avx2: {
+            static const auto available = cpuHasAvx2() ;
+            return available ;
+        }
+        case ColorKernel::sse2:
+            return true ;  // Every x86 processor we can be compiled for has SSE2
+#endif
+        case ColorKernel::scalar:
+            return true ;
+        default:
+            return false ;
+    }
+}
+//==============================================================================================================================
+auto bestColorKernel() -> ColorKernel {
+    static const auto best = colorKernelAvailable(ColorKernel::avx2) ? ColorKernel::avx2 : (colorKernelAvailable(ColorKernel::sse2) ? ColorKernel::sse2 : ColorKernel::scalar) ;
+    return best ;
+}
+
+//==============================================================================================================================
+// convertRows
+//==============================================================================================================================
+//==============================================================================================================================
+auto convertRows(const std::uint16_t *pixels, int width, int height, int depth, std::uint8_t *output, std::size_t stride) -> void {
+    convertRows(bestColorKernel(), pixels, width, height, depth, output, stride);
+}
+//==============================================================================================================================
+auto convertRows(ColorKernel kernel, const std::uint16_t *pixels, int width, int height, int depth, std::uint8_t *output, std::size_t stride) -> void {
+    auto row = (depth == 16 ? nullptr : rowFunction(kernel, depth, ChannelOrder::bgr)) ;
+    auto count = static_cast<std::size_t>(width) ;
+    for (auto line = 0 ; line < height ; line++) {
+        // The last source row goes first
+        auto source = pixels + static_cast<std::size_t>(height - 1 - line) * count ;
+        auto destination = output + static_cast<std::size_t>(line) * stride ;
+        if (row == nullptr) {
+            std::memcpy(destination, source, count * 2) ;
+        }
+        else {
+            row(source, width, destination) ;
+        }
+    }
+}
+
+//==============================================================================================================================
+// convertRow
+//==============================================================================================================================
+//==============================================================================================================================
+auto convertRow(const std::uint16_t *pixels, int count, int depth, ChannelOrder order, std::uint8_t *output) -> void {
+    convertRow(bestColorKernel(), pixels, count, depth, order, output);
+}
+//==============================================================================================================================
+auto convertRow(ColorKernel kernel, const std::uint16_t *pixels, int count, int depth, ChannelOrder order, std::uint8_t *output) -> void {
+    rowFunction(kernel, depth, order)(pixels, count, output);
+}
+
+//==============================================================================================================================
+// halveImage
+//==============================================================================================================================
+//==============================================================================================================================
+auto halveImage(const std::uint16_t *pixels, int width, int height, std::uint16_t *output) -> void {
+    halveImage(bestColorKernel(), pixels, width, height, output);
+}
+//==============================================================================================================================
+auto halveImage(ColorKernel kernel, const std::uint16_t *pixels, int width, int height, std::uint16_t *output) -> void {
+    if (!colorKernelAvailable(kernel)) {
+        throw std::runtime_error("Color kernel not available: "s + colorKernelName(kernel));
+    }
+    if (width < 2 || height < 2 || width % 2 != 0 || height % 2 != 0) {
+        throw std::runtime_error("Can not halve an image of "s + std::to_string(width) + "x"s + std::to_string(height));
+    }
+    // There is no AVX2 version, the SSE2 one is already limited by how fast the pixels can be read
+    auto row = scalarHalveRow ;
+#if defined(TEXTURE_HAVE_X86_KERNELS)
+    if (kernel != ColorKernel::scalar) {
+        row = sse2HalveRow ;
+    }
+#endif
+    auto stride = static_cast<std::size_t>(width) ;
+    for (auto line = 0 ; line < height / 2 ; line++) {
+        auto top = pixels + static_cast<std::size_t>(line) * 2 * stride ;
+        row(top, top + stride, width / 2, output + static_cast<std::size_t>(line) * static_cast<std::size_t>(width / 2)) ;
+    }
+}
@@ -0,0 +1,71 @@
+//
+
+#ifndef colorconvert_hpp
+#define colorconvert_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+//======================================================================
+/* Color conversion
+ Converts UO 0555 color words (see texturearchive.hpp) to the pixel layouts a BMP uses:
+    16 bit      The 0555 word as is (a BMP 16 bit pixel is also X1R5G5B5)
+    24 bit      Blue, Green, Red bytes (or Red, Green, Blue)
+    32 bit      Blue, Green, Red, Alpha bytes (or Red, Green, Blue, Alpha)
+ Each 5 bit channel is expanded to 8 bits by repeating its top bits in the bottom (so 0x1F becomes 0xFF, not 0xF8).
+ The "no color" value (0x0000, the unused top bit is ignored) becomes alpha 0 in 32 bit, every other color is alpha 255.
+ In 24 bit it is simply black.
+
+ For a BMP, the conversion also flips the rows, as the BMP wants the bottom row first, so the rows are only touched once.
+
+ It also has the averaging used to make the smaller (mip) levels of a texture (halveImage).
+
+ There is a plain c++ (scalar) version, which is the reference, and versions using the SSE2 and AVX2 vector
+ instructions of x86 processors, that convert 8 or 16 pixels at a time. The best one the processor we are running
+ on supports is picked the first time it is needed.  All of them produce exactly the same bytes.
+ */
+
+//==============================================================================================================================
+// ColorKernel
+//==============================================================================================================================
+enum class ColorKernel {
+    scalar,
+    sse2,
+    avx2
+};
+
+auto colorKernelName(ColorKernel kernel) -> const char* ;
+auto colorKernelAvailable(ColorKernel kernel) -> bool ;  // Was it compiled in, and does the processor support it
+auto bestColorKernel() -> ColorKernel ;
+
+//==============================================================================================================================
+// ChannelOrder
+//==============================================================================================================================
+// BMP stores the blue byte first, PNG and QOI store the red byte first
+enum class ChannelOrder {
+    bgr,
+    rgb
+};
+
+//==============================================================================================================================
+// Convert "height" rows of "width" 0555 pixels (top row first) to the given depth (16, 24, or 32), and write them bottom row
+// first to output.  "stride" is the number of bytes from the start of one output row to the next (so pad bytes, or a
+// wider image the rows are placed in, are skipped over and left untouched).
+auto convertRows(const std::uint16_t *pixels, int width, int height, int depth, std::uint8_t *output, std::size_t stride) -> void ;
+// The same, with a specific kernel.  Throws if that kernel is not available
+auto convertRows(ColorKernel kernel, const std::uint16_t *pixels, int width, int height, int depth, std::uint8_t *output, std::size_t stride) -> void ;
+
+//==============================================================================================================================
+// Convert one row of "count" 0555 pixels to 24 or 32 bits, with the channels in the given order (no flipping)
+auto convertRow(const std::uint16_t *pixels, int count, int depth, ChannelOrder order, std::uint8_t *output) -> void ;
+auto convertRow(ColorKernel kernel, const std::uint16_t *pixels, int count, int depth, ChannelOrder order, std::uint8_t *output) -> void ;
+
+//==============================================================================================================================
+// Halve an image of 0555 pixels (width and height must be even) by averaging each 2x2 block of pixels into one, writing
+// (width/2) * (height/2) pixels to output.  Each 5 bit channel is averaged separately (rounded to the nearest).
+// "No color" pixels are left out of the average, a block of only "no color" stays "no color", and colors that average
+// to 0 become 0x0421 (the darkest gray), so a colored block never becomes transparent.
+auto halveImage(const std::uint16_t *pixels, int width, int height, std::uint16_t *output) -> void ;
+auto halveImage(ColorKernel kernel, const std::uint16_t *pixels, int width, int height, std::uint16_t *output) -> void ;
+
+#endif /* colorconvert_hpp */
@@ -0,0 +1,83 @@
+//
+
+#include "dedup.hpp"
+
+#include <cstring>
+#include <unordered_map>
+
+#include "hash.hpp"
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    auto samePixels(const TextureArchive &archive, int first, int second) -> bool {
+        const auto &a = archive.entry(first) ;
+        const auto &b = archive.entry(second) ;
+        if (a.width() != b.width()) {
+            return false ;
+        }
+        if (a.offset == b.offset) {
+            return true ;  // The same data in the file
+        }
+        auto viewA = archive.view(first) ;
+        auto viewB = archive.view(second) ;
+        return std::memcmp(viewA.pixels, viewB.pixels, viewA.size()) == 0 ;
+    }
+}
+
+//==============================================================================================================================
+// ContentIndex
+//==============================================================================================================================
+//==============================================================================================================================
+auto ContentIndex::duplicate(int id) const -> bool {
+    auto index = static_cast<std::size_t>(id) ;
+    return index < canonical.size() && canonical[index] >= 0 && canonical[index] != id ;
+}
+//==============================================================================================================================
+auto ContentIndex::duplicates() const -> std::size_t {
+    auto count = std::size_t(0) ;
+    for (auto id = 0 ; id < static_cast<int>(canonical.size()) ; id++) {
+        if (duplicate(id)) {
+            count++ ;
+        }
+    }
+    return count ;
+}
+//==============================================================================================================================
+auto ContentIndex::build(const TextureArchive &archive, WorkPool &pool, bool findDuplicates) -> ContentIndex {
+    auto index = ContentIndex() ;
+    index.hashes = std::vector<std::uint64_t>(archive.size(), 0) ;
+    index.canonical = std::vector<int>(archive.size(), -1) ;
+    // Hashing is the expensive part, so that is spread over the workers (each writes only its own entry)
+    pool.run(archive.size(), [&](std::size_t entry, int){
+        auto id = static_cast<int>(entry) ;
+        if (archive.valid(id)) {
+            auto texture = archive.view(id) ;
+            index.hashes[entry] = hash64(texture.pixels, texture.size()) ;
+            index.canonical[entry] = id ;
+        }
+    });
+    if (!findDuplicates) {
+        return index ;
+    }
+    // Then, in id order (so the lowest id always wins), find the first entry with the same pixels
+    auto seen = std::unordered_map<std::uint64_t, std::vector<int>>() ;
+    for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+        if (!archive.valid(id)) {
+            continue ;
+        }
+        auto &candidates = seen[index.hashes[static_cast<std::size_t>(id)]] ;
+        auto match = id ;
+        for (auto candidate : candidates) {
+            if (samePixels(archive, candidate, id)) {
+                match = candidate ;
+                break ;
+            }
+        }
+        if (match == id) {
+            candidates.push_back(id);
+        }
+        index.canonical[static_cast<std::size_t>(id)] = match ;
+    }
+    return index ;
+}
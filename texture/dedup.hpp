@@ -0,0 +1,32 @@
+//
+
+#ifndef dedup_hpp
+#define dedup_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "texturearchive.hpp"
+#include "workpool.hpp"
+
+//==============================================================================================================================
+// ContentIndex
+//==============================================================================================================================
+/*
+ Many textures in texmaps.mul have exactly the same pixels (and some index entries even point at the same data).
+ The content index hashes the pixels of every valid entry (see hash.hpp), and for each entry records the first
+ (lowest) id that has the same pixels, its "canonical" id.  An entry whose canonical id is not itself is a duplicate.
+ Entries with the same hash are compared byte for byte before being called the same, so a hash collision can not
+ make two different textures be treated as one.
+ */
+struct ContentIndex {
+    std::vector<std::uint64_t> hashes ;  // For each id, the hash of its pixels (0 for invalid entries)
+    std::vector<int> canonical ;  // For each id, the first id with the same pixels (-1 for invalid entries)
+    auto duplicate(int id) const -> bool ;
+    auto duplicates() const -> std::size_t ;  // The number of entries that are duplicates
+    // If findDuplicates is false, only the hashes are calculated, and every valid entry is its own canonical id
+    static auto build(const TextureArchive &archive, WorkPool &pool, bool findDuplicates = true) -> ContentIndex ;
+};
+
+#endif /* dedup_hpp */
@@ -0,0 +1,301 @@
+//
+
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#if defined(TEXTURE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+using namespace std::string_literals ;
+
+#if defined(TEXTURE_HAVE_ZLIB)
+//==============================================================================================================================
+// DeflateStream (with zlib)
+//==============================================================================================================================
+struct DeflateStream::State {
+    FileData &output ;
+    z_stream stream ;
+    bool finished ;
+    State(FileData &output, int level):output(output),stream(),finished(false) {
+        if (deflateInit(&stream, level) != Z_OK) {
+            throw std::runtime_error("Unable to start zlib compression at level "s + std::to_string(level));
+        }
+    }
+    ~State() {
+        deflateEnd(&stream);
+    }
+    // Run deflate on whatever input it has, growing the output as needed
+    auto run(int flush) -> void {
+        auto status = Z_OK ;
+        do {
+            auto used = output.size() ;
+            output.resize(used + 16384) ;
+            stream.next_out = output.data() + used ;
+            stream.avail_out = 16384 ;
+            status = deflate(&stream, flush) ;
+            output.resize(output.size() - stream.avail_out) ;
+            if (status == Z_STREAM_ERROR) {
+                throw std::runtime_error("zlib compression failed");
+            }
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END)) ;
+    }
+};
+
+//==============================================================================================================================
+DeflateStream::DeflateStream(FileData &output, int level):state(std::make_unique<State>(output, level)) {
+}
+//==============================================================================================================================
+DeflateStream::~DeflateStream() = default ;
+//==============================================================================================================================
+auto DeflateStream::write(const std::uint8_t *data, std::size_t length) -> void {
+    if (state->finished) {
+        throw std::runtime_error("Write to a finished deflate stream");
+    }
+    // avail_in is only 32 bits, so very large pieces are given to zlib a bit at a time
+    while (length > 0) {
+        auto piece = std::min<std::size_t>(length, 1 << 30) ;
+        state->stream.next_in = const_cast<std::uint8_t*>(data) ;
+        state->stream.avail_in = static_cast<uInt>(piece) ;
+        state->run(Z_NO_FLUSH);
+        data += piece ;
+        length -= piece ;
+    }
+}
+//==============================================================================================================================
+auto DeflateStream::finish() -> void {
+    if (!state->finished) {
+        state->stream.next_in = nullptr ;
+        state->stream.avail_in = 0 ;
+        state->run(Z_FINISH);
+        state->finished = true ;
+    }
+}
+
+#else
+//======================================================================
+namespace {
+    constexpr auto windowSize = std::size_t(32768) ;  // How far back a repeat can be
+    constexpr auto blockSize = std::size_t(65536) ;  // How much input we gather before compressing it
+    constexpr auto hashBits = 15 ;
+    constexpr auto minMatch = std::size_t(3) ;
+    constexpr auto maxMatch = std::size_t(258) ;
+
+    // Lengths 3-258 are coded as one of 29 codes (257-285), plus extra bits
+    constexpr auto lengthBase = std::array<std::uint16_t,29>{3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258} ;
+    constexpr auto lengthExtra = std::array<std::uint8_t,29>{0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0} ;
+    // Distances 1-32768 are coded as one of 30 codes, plus extra bits
+    constexpr auto distanceBase = std::array<std::uint16_t,30>{1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577} ;
+    constexpr auto distanceExtra = std::array<std::uint8_t,30>{0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13} ;
+
+    //==========================================================================================================================
+    // Huffman codes are sent most significant bit first, everything else least significant bit first
+    auto reverseBits(std::uint32_t code, int bits) -> std::uint32_t {
+        auto reversed = std::uint32_t(0) ;
+        for (auto i = 0 ; i < bits ; i++) {
+            reversed = (reversed << 1) | ((code >> i) & 1) ;
+        }
+        return reversed ;
+    }
+}
+
+//==============================================================================================================================
+// DeflateStream (our own)
+//==============================================================================================================================
+struct DeflateStream::State {
+    FileData &output ;
+    int maxChain ;  // How many earlier places with the same hash we compare against
+    std::uint32_t adlerA ;
+    std::uint32_t adlerB ;
+    // The input we have not compressed yet, and the window before it (that repeats can refer back to).
+    // window[0] is at position "base" of the whole input, and everything before "done" has been compressed.
+    std::vector<std::uint8_t> window ;
+    std::size_t base ;
+    std::size_t done ;
+    // For each hash of 3 bytes, the last position (+1, 0 is none) it was seen at, and for each position (in the last
+    // windowSize), the position before that with the same hash
+    std::vector<std::size_t> head ;
+    std::vector<std::size_t> previous ;
+    std::uint64_t bits ;
+    int bitCount ;
+    bool finished ;
+
+    State(FileData &output, int level):output(output),maxChain(level <= 0 ? 0 : 2 << level),adlerA(1),adlerB(0),base(0),done(0),head(std::size_t(1) << hashBits, 0),previous(windowSize, 0),bits(0),bitCount(0),finished(false) {
+        if (level < 0 || level > 9) {
+            throw std::runtime_error("Invalid compression level: "s + std::to_string(level));
+        }
+        output.push_back(0x78) ;  // Deflate, with a 32K window
+        output.push_back(0x01) ;  // No dictionary, and the check bits that make the header a multiple of 31
+    }
+    //==========================================================================================================================
+    auto putBits(std::uint32_t value, int count) -> void {
+        bits |= static_cast<std::uint64_t>(value) << bitCount ;
+        bitCount += count ;
+        while (bitCount >= 8) {
+            output.push_back(static_cast<std::uint8_t>(bits & 0xFF));
+            bits >>= 8 ;
+            bitCount -= 8 ;
+        }
+    }
+    //==========================================================================================================================
+    auto alignToByte() -> void {
+        if (bitCount > 0) {
+            putBits(0, 8 - bitCount);
+        }
+    }
+    //==========================================================================================================================
+    // A literal byte, a length code, or the end of block, with the fixed Huffman codes
+    auto putSymbol(std::uint32_t symbol) -> void {
+        if (symbol < 144) {
+            putBits(reverseBits(0x30 + symbol, 8), 8);
+        }
+        else if (symbol < 256) {
+            putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+        }
+        else if (symbol < 280) {
+            putBits(reverseBits(symbol - 256, 7), 7);
+        }
+        else {
+            putBits(reverseBits(0xC0 + symbol - 280, 8), 8);
+        }
+    }
+    //==========================================================================================================================
+    auto putMatch(std::size_t length, std::size_t distance) -> void {
+        auto code = std::size_t(28) ;
+        if (length < maxMatch) {
+            code = static_cast<std::size_t>(std::upper_bound(lengthBase.begin(), lengthBase.end() - 1, length) - lengthBase.begin()) - 1 ;
+        }
+        putSymbol(static_cast<std::uint32_t>(257 + code));
+        putBits(static_cast<std::uint32_t>(length - lengthBase[code]), lengthExtra[code]);
+        auto distanceCode = static_cast<std::size_t>(std::upper_bound(distanceBase.begin(), distanceBase.end(), distance) - distanceBase.begin()) - 1 ;
+        putBits(reverseBits(static_cast<std::uint32_t>(distanceCode), 5), 5);
+        putBits(static_cast<std::uint32_t>(distance - distanceBase[distanceCode]), distanceExtra[distanceCode]);
+    }
+    //==========================================================================================================================
+    auto hashAt(std::size_t index) const -> std::size_t {
+        return ((static_cast<std::size_t>(window[index]) << 10) ^ (static_cast<std::size_t>(window[index + 1]) << 5) ^ window[index + 2]) & ((std::size_t(1) << hashBits) - 1) ;
+    }
+    //==========================================================================================================================
+    auto insert(std::size_t index) -> void {
+        auto hash = hashAt(index) ;
+        previous[(base + index) % windowSize] = head[hash] ;
+        head[hash] = base + index + 1 ;
+    }
+    //==========================================================================================================================
+    // The longest earlier repeat of the bytes at index (not reaching past end), as length and distance
+    auto longestMatch(std::size_t index, std::size_t end, std::size_t &distance) const -> std::size_t {
+        auto best = std::size_t(0) ;
+        auto limit = std::min(maxMatch, end - index) ;
+        auto position = base + index ;
+        auto candidate = head[hashAt(index)] ;
+        for (auto chain = 0 ; candidate != 0 && chain < maxChain ; chain++) {
+            auto earlier = candidate - 1 ;
+            if (position - earlier > windowSize) {
+                break ;  // Too far back (and everything further along the chain is further still)
+            }
+            auto other = earlier - base ;
+            auto length = std::size_t(0) ;
+            while (length < limit && window[other + length] == window[index + length]) {
+                length++ ;
+            }
+            if (length > best) {
+                best = length ;
+                distance = position - earlier ;
+                if (best == limit) {
+                    break ;
+                }
+            }
+            candidate = previous[earlier % windowSize] ;
+        }
+        return best ;
+    }
+    //==========================================================================================================================
+    // Compress the input from done up to end as one block
+    auto compress(std::size_t end, bool last) -> void {
+        if (maxChain == 0) {
+            // Stored blocks, at most 65535 bytes each
+            do {
+                auto length = std::min<std::size_t>(end - done, 65535) ;
+                putBits((last && done + length == end) ? 1 : 0, 3);
+                alignToByte();
+                putBits(static_cast<std::uint32_t>(length), 16);
+                putBits(static_cast<std::uint32_t>(~length & 0xFFFF), 16);
+                output.insert(output.end(), window.begin() + static_cast<std::ptrdiff_t>(done), window.begin() + static_cast<std::ptrdiff_t>(done + length));
+                done += length ;
+            } while (done < end) ;
+        }
+        else {
+            putBits(last ? 1 : 0, 1);
+            putBits(1, 2);  // Fixed Huffman codes
+            auto index = done ;
+            while (index < end) {
+                auto distance = std::size_t(0) ;
+                auto length = (index + minMatch <= end ? longestMatch(index, end, distance) : 0) ;
+                if (length >= minMatch) {
+                    putMatch(length, distance);
+                }
+                else {
+                    putSymbol(window[index]);
+                    length = 1 ;
+                }
+                for (auto skip = std::size_t(0) ; skip < length ; skip++, index++) {
+                    if (index + minMatch <= end) {
+                        insert(index);
+                    }
+                }
+            }
+            putSymbol(256);  // End of block
+            done = end ;
+        }
+        // Drop what is too far back to be referred to (only now and then, so we are not always moving the data)
+        if (done > 2 * windowSize) {
+            auto drop = done - windowSize ;
+            window.erase(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(drop));
+            base += drop ;
+            done -= drop ;
+        }
+    }
+};
+
+//==============================================================================================================================
+DeflateStream::DeflateStream(FileData &output, int level):state(std::make_unique<State>(output, level)) {
+}
+//==============================================================================================================================
+DeflateStream::~DeflateStream() = default ;
+//==============================================================================================================================
+auto DeflateStream::write(const std::uint8_t *data, std::size_t length) -> void {
+    if (state->finished) {
+        throw std::runtime_error("Write to a finished deflate stream");
+    }
+    // The Adler-32 checksum, taking the modulo only as often as needed to not overflow
+    for (auto i = std::size_t(0) ; i < length ; ) {
+        auto piece = std::min<std::size_t>(length - i, 5552) ;
+        for (auto end = i + piece ; i < end ; i++) {
+            state->adlerA += data[i] ;
+            state->adlerB += state->adlerA ;
+        }
+        state->adlerA %= 65521 ;
+        state->adlerB %= 65521 ;
+    }
+    state->window.insert(state->window.end(), data, data + length);
+    while (state->window.size() - state->done >= blockSize) {
+        state->compress(state->done + blockSize, false);
+    }
+}
+//==============================================================================================================================
+auto DeflateStream::finish() -> void {
+    if (!state->finished) {
+        state->compress(state->window.size(), true);
+        state->alignToByte();
+        auto adler = (state->adlerB << 16) | state->adlerA ;
+        for (auto shift = 24 ; shift >= 0 ; shift -= 8) {
+            state->output.push_back(static_cast<std::uint8_t>((adler >> shift) & 0xFF)) ;
+        }
+        state->finished = true ;
+    }
+}
+#endif
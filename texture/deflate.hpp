@@ -0,0 +1,40 @@
+//
+
+#ifndef deflate_hpp
+#define deflate_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "filedata.hpp"
+
+//==============================================================================================================================
+// DeflateStream
+//==============================================================================================================================
+/*
+ Compresses data into the zlib format (RFC 1950: a two byte header, deflate compressed data (RFC 1951), and an
+ Adler-32 checksum of the uncompressed data), which is what a PNG stores its pixels in.
+ The data is given in pieces (a PNG gives it a row at a time), and the compressed bytes are appended to the output
+ vector as they are made, so the uncompressed data never has to be in memory all at once.
+
+ The level is 0 (no compression, the data is stored as is) to 9 (smallest output, slowest).
+ If the program was built with zlib (TEXTURE_HAVE_ZLIB, see CMakeLists.txt), zlib does the work.  Otherwise our own,
+ simpler, compressor is used: it finds repeats (LZ77) with hash chains that are searched longer the higher the level,
+ and codes them with deflate's fixed Huffman codes.  Both produce a standard stream any PNG reader understands, zlib's
+ is just a bit smaller.
+ */
+class DeflateStream {
+    struct State ;
+    std::unique_ptr<State> state ;
+public:
+    DeflateStream(FileData &output, int level) ;
+    ~DeflateStream() ;
+    DeflateStream(const DeflateStream &) = delete ;
+    auto operator=(const DeflateStream &) -> DeflateStream& = delete ;
+    auto write(const std::uint8_t *data, std::size_t length) -> void ;
+    auto finish() -> void ;  // Compress whatever is left, and end the stream.  Nothing can be written after
+};
+
+#endif /* deflate_hpp */
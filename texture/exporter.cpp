@@ -0,0 +1,439 @@
+//
+
+#include "exporter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "atlas.hpp"
+#include "dedup.hpp"
+#include "filesink.hpp"
+#include "hash.hpp"
+#include "manifest.hpp"
+#include "mipmap.hpp"
+#include "stats.hpp"
+#include "workpool.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    // Where finished files go.  With one job, they are gathered into batches and written on this thread.  Otherwise,
+    // they are handed to an OutputWriter.  We only allow a few finished files per worker to be waiting on the writer,
+    // which caps the memory we use.  Either way, the files are written by a FileSink (see filesink.hpp).  We also keep
+    // a total of what was written, for each type of file.  That is counted when the sink says a file was written (not
+    // when it was handed over), so a file that failed is not counted.
+    class Output {
+        std::unique_ptr<OutputWriter> writer ;
+        std::unique_ptr<FileSink> sink ;  // Only with one job
+        std::vector<OutputFile> batch ;
+        std::mutex totalsLock ;  // For all of the below (with several jobs, the writer's thread updates them)
+        std::vector<std::string> failed ;
+        std::set<std::string> failedNames ;
+        std::size_t written ;
+        std::map<std::string, WrittenTotal> totals ;
+        auto completed(const OutputFile &file, const std::string &error) -> void {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            if (!error.empty()) {
+                failed.push_back(error);
+                failedNames.insert(file.name);
+                return ;
+            }
+            auto dot = file.name.rfind('.') ;
+            auto &total = totals[dot == std::string::npos ? ""s : file.name.substr(dot + 1)] ;
+            total.files++ ;
+            total.bytes += file.data.size() ;
+            written++ ;
+        }
+        auto flush() -> void {
+            auto errors = sink->write(batch) ;
+            for (auto i = std::size_t(0) ; i < batch.size() ; i++) {
+                completed(batch[i], errors[i]);
+            }
+            batch.clear();
+        }
+    public:
+        explicit Output(const Options &options):written(0) {
+            auto fileSink = FileSink::create(options.writer, static_cast<std::size_t>(options.queueDepth)) ;
+            if (options.jobs > 1) {
+                writer = std::make_unique<OutputWriter>(static_cast<std::size_t>(options.jobs) * 4, std::move(fileSink), [this](const OutputFile &file, const std::string &error){
+                    completed(file, error);
+                });
+            }
+            else {
+                sink = std::move(fileSink) ;
+            }
+        }
+        auto add(OutputFile &&file) -> void {
+            if (writer) {
+                auto timer = StageTimer(Stage::submitWait) ;
+                writer->submit(std::move(file));
+            }
+            else {
+                batch.push_back(std::move(file));
+                if (batch.size() >= sink->depth()) {
+                    flush();
+                }
+            }
+        }
+        // Everything added is written by the time this returns.  Nothing more can be added after (the writer's queue is
+        // closed), but calling it again is harmless.
+        auto finish() -> void {
+            if (writer) {
+                writer->finish();
+            }
+            else if (!batch.empty()) {
+                flush();
+            }
+        }
+        auto count() -> std::size_t {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            return written ;
+        }
+        auto formats() -> std::map<std::string, WrittenTotal> {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            return totals ;
+        }
+        auto failures() -> std::vector<std::string> {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            return failed ;
+        }
+        // Was the file handed to us, and could not be written (only known once it is finished)
+        auto failedToWrite(const std::string &name) -> bool {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            return failedNames.count(name) > 0 ;
+        }
+        // Something other than writing a file failed (a link), it is reported the same way
+        auto fail(const std::string &error) -> void {
+            auto lock = std::lock_guard<std::mutex>(totalsLock) ;
+            failed.push_back(error);
+        }
+    };
+    //==========================================================================================================================
+    // Run the work, making sure the writer is finished (and its error, which would be the real problem, reported) if
+    // something goes wrong.
+    template <typename Work>
+    auto runWith(Output &output, Work &&work) -> void {
+        try {
+            work();
+        }
+        catch(...) {
+            output.finish();
+            throw ;
+        }
+        output.finish();
+    }
+    //==========================================================================================================================
+    auto textureName(int id, const std::string &extension, int level = 0) -> std::string {
+        // Make the file name just be the entry number in hex. Make all entry names be 4 characters, and pad with 0 (what the 04 does). Upper case the hex (why capital X)
+        // A mip level gets its number added (0x0001_1 is half the size of 0x0001)
+        char filestring[16] ;
+        std::snprintf(filestring, sizeof(filestring), "0x%04X",static_cast<unsigned>(id));
+        if (level > 0) {
+            return filestring + "_"s + std::to_string(level) + extension ;
+        }
+        return filestring + extension ;
+    }
+    //==========================================================================================================================
+    // The number of mip levels written after the texture itself (none without the mips option)
+    auto mipLevels(const Options &options, int width) -> int {
+        return options.mips ? MipChain::levelCount(width) : 0 ;
+    }
+    //==========================================================================================================================
+    // The size of the one buffer a mip chain keeps all its levels in
+    auto mipChainBytes(const MipChain &chain) -> std::size_t {
+        auto pixels = std::size_t(0) ;
+        for (auto level = 1 ; level <= chain.levels() ; level++) {
+            pixels += static_cast<std::size_t>(chain.width(level)) * static_cast<std::size_t>(chain.width(level)) ;
+        }
+        return pixels * sizeof(std::uint16_t) ;
+    }
+    //==========================================================================================================================
+    auto removeOutput(int id, const std::string &extension, int levels) -> void {
+        for (auto level = 0 ; level <= levels ; level++) {
+            std::filesystem::remove(textureName(id, extension, level));
+        }
+    }
+    //==========================================================================================================================
+    // For dedup alias mode, the list of which files the duplicate ids are the same as
+    auto aliasTable(const ContentIndex &content, const std::string &extension) -> OutputFile {
+        auto text = "{\n  \"aliases\": [\n"s ;
+        auto first = true ;
+        for (auto id = 0 ; id < static_cast<int>(content.canonical.size()) ; id++) {
+            if (content.duplicate(id)) {
+                auto same = content.canonical[static_cast<std::size_t>(id)] ;
+                text += (first ? ""s : ",\n"s) + "    {\"id\": "s + std::to_string(id) + ", \"same_as\": "s + std::to_string(same) + ", \"file\": \""s + textureName(same, extension) + "\"}"s ;
+                first = false ;
+            }
+        }
+        text += (first ? ""s : "\n"s) + "  ]\n}\n"s ;
+        return OutputFile{"aliases.json"s, FileData(text.begin(), text.end())} ;
+    }
+    //==========================================================================================================================
+    // Which entries need to be encoded this run.  Normally every valid one, but an incremental export skips the ones
+    // that are the same as the last export (and cleans up the output of the ones that are gone).
+    auto planWork(const TextureArchive &archive, const Options &options, const std::string &extension, const ContentIndex &content, const Manifest &manifest, ExportSummary &summary) -> std::vector<bool> {
+        auto pending = std::vector<bool>(archive.size(), false) ;
+        for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+            pending[static_cast<std::size_t>(id)] = archive.valid(id) ;
+        }
+        auto previous = Manifest() ;
+        if (!options.incremental || !previous.load(Manifest::filename) || previous.settingsHash() != manifest.settingsHash()) {
+            return pending ;  // No (usable) earlier export to compare with, so everything is done
+        }
+        summary.incremental = true ;
+        auto diff = manifest.diff(previous) ;
+        summary.added = diff.added.size() ;
+        summary.changed = diff.changed.size() ;
+        summary.removed = diff.removed.size() ;
+        summary.unchanged = diff.unchanged ;
+        if (options.atlas) {
+            // The pages are all rebuilt if anything at all changed
+            if (diff.empty() && std::filesystem::exists("atlas.json")) {
+                std::fill(pending.begin(), pending.end(), false);
+            }
+            return pending ;
+        }
+        std::fill(pending.begin(), pending.end(), false);
+        for (auto id : diff.added) {
+            pending[static_cast<std::size_t>(id)] = true ;
+        }
+        for (auto id : diff.changed) {
+            pending[static_cast<std::size_t>(id)] = true ;
+        }
+        for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+            auto index = static_cast<std::size_t>(id) ;
+            if (!archive.valid(id) || pending[index]) {
+                continue ;
+            }
+            // If its output went missing since, it has to be made again.  A hard link is made again if what it
+            // links to is being made again.
+            auto hasFile = !(options.dedup == DedupMode::alias && content.duplicate(id)) ;
+            auto missing = false ;
+            for (auto level = 0 ; hasFile && level <= mipLevels(options, archive.entry(id).width()) ; level++) {
+                missing = missing || !std::filesystem::exists(textureName(id, extension, level)) ;
+            }
+            if (missing) {
+                pending[index] = true ;
+            }
+            else if (options.dedup == DedupMode::link && content.duplicate(id) && pending[static_cast<std::size_t>(content.canonical[index])]) {
+                pending[index] = true ;
+            }
+        }
+        for (auto id : diff.removed) {
+            removeOutput(id, extension, mipLevels(options, TextureEntry{0, 0, previous.entry(id).flag}.width()));
+        }
+        return pending ;
+    }
+    //==========================================================================================================================
+    auto exportFiles(const TextureArchive &archive, const Options &options, const ImageEncoder &encoder, const ContentIndex &content, const std::vector<bool> &pending, WorkPool &pool, Output &output, ExportSummary &summary) -> void {
+        auto extension = encoder.extension() ;
+        // Only the first of each set of identical textures is encoded (without dedup, every entry is its own first).
+        // We remember how big it was (with its mip levels), so we know what each duplicate saved.
+        auto sizes = std::vector<std::size_t>(archive.size(), 0) ;
+        pool.run(archive.size(), [&](std::size_t index, int){
+            auto id = static_cast<int>(index) ;
+            if (!pending[index]) {
+                return ;
+            }
+            // Whatever was there is removed before it is written, in every mode.  An earlier dedup link export may
+            // have left it as a hard link, and writing through that would change every file it is linked to.
+            removeOutput(id, extension, mipLevels(options, archive.entry(id).width()));
+            if (!content.duplicate(id)) {
+                auto texture = archive.view(id) ;
+                Stats::add(Counter::texturesRead);
+                Stats::add(Counter::bytesRead, texture.size());
+                auto encodeTimer = StageTimer(Stage::encode) ;
+                auto file = encodeTexture(texture, encoder) ;
+                encodeTimer.stop();
+                Stats::allocated(file.data.capacity());
+                sizes[index] = file.data.size() ;
+                output.add(std::move(file));
+                if (options.mips) {
+                    // Made right away, while the texture's pixels are still in the processor's cache
+                    auto mipsTimer = StageTimer(Stage::mips) ;
+                    auto chain = MipChain(texture.pixels, texture.width) ;
+                    mipsTimer.stop();
+                    Stats::allocated(mipChainBytes(chain));
+                    for (auto level = 1 ; level <= chain.levels() ; level++) {
+                        auto mipTimer = StageTimer(Stage::encode) ;
+                        auto mip = OutputFile{textureName(id, extension, level), encoder.encode(chain.level(level), chain.width(level), chain.width(level))} ;
+                        mipTimer.stop();
+                        Stats::allocated(mip.data.capacity());
+                        sizes[index] += mip.data.size() ;
+                        output.add(std::move(mip));
+                    }
+                }
+            }
+        });
+        if (options.dedup == DedupMode::off) {
+            return ;
+        }
+        auto anything = std::find(pending.begin(), pending.end(), true) != pending.end() ;
+        if (options.dedup == DedupMode::alias && (anything || !summary.incremental || summary.removed > 0)) {
+            output.add(aliasTable(content, extension));
+        }
+        // A link can only be made once the file it links to is written
+        output.finish();
+        for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+            auto index = static_cast<std::size_t>(id) ;
+            if (!pending[index] || !content.duplicate(id)) {
+                continue ;
+            }
+            auto same = content.canonical[index] ;
+            auto levels = mipLevels(options, archive.entry(id).width()) ;
+            auto saved = sizes[static_cast<std::size_t>(same)] ;
+            for (auto level = 0 ; level <= levels ; level++) {
+                auto target = textureName(same, extension, level) ;
+                auto error = std::error_code() ;
+                if (options.dedup == DedupMode::link) {
+                    auto name = textureName(id, extension, level) ;
+                    // A file that could not be written is not there to link to, the failure was already reported
+                    if (output.failedToWrite(target)) {
+                        output.fail(name + ": not linked, as "s + target + " could not be written"s);
+                        continue ;
+                    }
+                    auto timer = StageTimer(Stage::link) ;
+                    std::filesystem::create_hard_link(target, name, error);
+                    timer.stop();
+                    if (error) {
+                        output.fail(name + ": "s + error.message());
+                        continue ;
+                    }
+                    Stats::add(Counter::links);
+                }
+                if (sizes[static_cast<std::size_t>(same)] == 0) {
+                    auto size = std::filesystem::file_size(target, error) ;
+                    saved += (error ? 0 : static_cast<std::size_t>(size)) ;
+                }
+            }
+            summary.duplicates++ ;
+            summary.bytesSaved += saved ;
+            summary.writesSaved += static_cast<std::size_t>(levels) + 1 ;
+        }
+    }
+    //==========================================================================================================================
+    auto exportAtlas(const TextureArchive &archive, const Options &options, const ImageEncoder &encoder, const ContentIndex &content, const std::vector<bool> &pending, WorkPool &pool, Output &output, ExportSummary &summary) -> void {
+        if (std::find(pending.begin(), pending.end(), true) == pending.end()) {
+            return ;  // Nothing has changed since the last time
+        }
+        auto atlas = AtlasBuilder(options.atlasSize, encoder.extension()) ;
+        // The layout is decided in id order, so it is the same no matter how many jobs we have.
+        // A duplicate shares the place of the texture it is the same as.  Each mip level is placed like
+        // another (smaller) texture.
+        auto placed = std::vector<std::vector<AtlasPlacement>>(archive.size()) ;
+        for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+            if (!archive.valid(id)) {
+                continue ;
+            }
+            auto &levels = placed[static_cast<std::size_t>(id)] ;
+            if (content.duplicate(id)) {
+                for (const auto &same : placed[static_cast<std::size_t>(content.canonical[static_cast<std::size_t>(id)])]) {
+                    levels.push_back(atlas.alias(id, same));
+                    summary.bytesSaved += static_cast<std::size_t>(same.size) * static_cast<std::size_t>(same.size) * static_cast<std::size_t>(options.depth / 8) ;
+                    summary.writesSaved++ ;  // A cell not drawn (or encoded)
+                }
+                summary.duplicates++ ;
+            }
+            else {
+                auto width = archive.entry(id).width() ;
+                for (auto level = 0 ; level <= mipLevels(options, width) ; level++) {
+                    levels.push_back(atlas.place(id, width >> level, level));
+                }
+            }
+        }
+        atlas.allocate();
+        // An earlier export may have needed more pages than this one, those would be left over (and not in atlas.json)
+        for (auto page = static_cast<int>(atlas.pageCount()) ; ; page++) {
+            auto error = std::error_code() ;
+            if (!std::filesystem::remove(atlas.pageName(page), error)) {
+                break ;
+            }
+        }
+        pool.run(archive.size(), [&](std::size_t index, int){
+            auto id = static_cast<int>(index) ;
+            const auto &levels = placed[index] ;
+            if (levels.empty() || content.duplicate(id)) {
+                return ;
+            }
+            auto texture = archive.view(id) ;
+            Stats::add(Counter::texturesRead);
+            Stats::add(Counter::bytesRead, texture.size());
+            auto timer = StageTimer(Stage::draw) ;
+            atlas.draw(levels[0], texture.pixels);
+            if (levels.size() > 1) {
+                auto mipsTimer = StageTimer(Stage::mips) ;
+                auto chain = MipChain(texture.pixels, texture.width) ;
+                mipsTimer.stop();
+                Stats::allocated(mipChainBytes(chain));
+                for (auto level = 1 ; level < static_cast<int>(levels.size()) ; level++) {
+                    atlas.draw(levels[static_cast<std::size_t>(level)], chain.level(level));
+                }
+            }
+        });
+        pool.run(atlas.pageCount(), [&](std::size_t page, int){
+            auto timer = StageTimer(Stage::encode) ;
+            auto file = atlas.encodePage(page, encoder) ;
+            timer.stop();
+            output.add(std::move(file));
+        });
+        output.add(atlas.binaryTable());
+        output.add(atlas.jsonTable());
+    }
+}
+
+//==============================================================================================================================
+auto encodeTexture(const TextureView &texture, const ImageEncoder &encoder) -> OutputFile {
+    // The whole file is built in one buffer, so it can be handed to another thread, and written with one write.
+    return OutputFile{textureName(texture.id, encoder.extension()), encoder.encode(texture.pixels, texture.width, texture.width)} ;
+}
+
+//==============================================================================================================================
+auto exportTextures(const TextureArchive &archive, const Options &options) -> ExportSummary {
+    // With one job, the pool just runs everything in order on this thread
+    auto pool = WorkPool(options.jobs) ;
+    auto output = Output(options) ;
+    auto summary = ExportSummary{archive.size(), 0, 0, 0, 0, false, 0, 0, 0, 0, {}, {}} ;
+    auto encoder = ImageEncoder::create(options.format, options.depth, options.level) ;
+    // The hashes are needed for the manifest, even if we are not looking for duplicates
+    auto hashTimer = StageTimer(Stage::contentHash) ;
+    auto content = ContentIndex::build(archive, pool, options.dedup != DedupMode::off) ;
+    hashTimer.stop();
+    auto planTimer = StageTimer(Stage::plan) ;
+    auto manifest = Manifest(archive, content, hash64(options.outputSettings().data(), options.outputSettings().size())) ;
+    auto pending = planWork(archive, options, encoder->extension(), content, manifest, summary) ;
+    planTimer.stop();
+    runWith(output, [&]{
+        if (options.atlas) {
+            exportAtlas(archive, options, *encoder, content, pending, pool, output, summary);
+        }
+        else {
+            exportFiles(archive, options, *encoder, content, pending, pool, output, summary);
+        }
+    });
+    summary.written = output.count() ;
+    summary.formats = output.formats() ;
+    summary.failures = output.failures() ;
+    // Only once everything is written, do we record what we wrote.  If anything could not be written, the old manifest
+    // is left as it was, so the next incremental export does not think this one worked.
+    // The manifest is only kept for incremental exports, a normal export leaves nothing but the images behind.  It may
+    // have written over the files an earlier manifest describes though (with other settings), so that one is removed.
+    if (!options.incremental) {
+        auto error = std::error_code() ;
+        std::filesystem::remove(Manifest::filename, error);
+    }
+    else if (summary.failures.empty()) {
+        auto manifestTimer = StageTimer(Stage::manifest) ;
+        manifest.save(Manifest::filename);
+    }
+    return summary ;
+}
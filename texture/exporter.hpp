@@ -0,0 +1,55 @@
+//
+
+#ifndef exporter_hpp
+#define exporter_hpp
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "imageencoder.hpp"
+#include "options.hpp"
+#include "outputwriter.hpp"
+#include "texturearchive.hpp"
+
+//==============================================================================================================================
+// Export
+//==============================================================================================================================
+/*
+ Converts every valid texture in the archive to a "0x%04X.bmp" (or .qoi/.png, see imageencoder.hpp) file in the
+ current directory, or with the atlas option, packs them into a few atlas pages (see atlas.hpp).
+ With dedup on, textures with the same pixels as an earlier one are not encoded again (see dedup.hpp).
+ An incremental export saves a manifest of what was exported, and the next one only does the entries that changed
+ since then (see manifest.hpp).
+ With more than one job, the textures are encoded on a WorkPool, and written by an OutputWriter. Each file is
+ encoded the same way either way, so the output does not depend on the number of jobs (only the order the files are
+ created in does).
+ The files are written in batches by a FileSink (see filesink.hpp).  A file that can not be written (or a hard link
+ that can not be made) does not stop the export, it is listed in the summary's failures (and then the manifest is not
+ updated).  The totals only count what was actually written.
+ */
+struct WrittenTotal {
+    std::size_t files ;
+    std::size_t bytes ;
+};
+
+struct ExportSummary {
+    std::size_t entries ;  // Number of index entries looked at
+    std::size_t written ;  // Number of files written
+    std::size_t duplicates ;  // Number of textures that were the same as an earlier one (with dedup on)
+    std::size_t bytesSaved ;  // Bytes not written because of that
+    std::size_t writesSaved ;  // Files (or in atlas mode, cells of a page) not written because of that
+    bool incremental ;  // Was this an incremental export (there was a manifest from an earlier one, with the same settings)
+    std::size_t added ;  // For an incremental export, what changed since the last one
+    std::size_t changed ;
+    std::size_t removed ;
+    std::size_t unchanged ;
+    std::map<std::string, WrittenTotal> formats ;  // What was written, by file extension ("bmp", "png", "json", ...)
+    std::vector<std::string> failures ;  // "name: why" for each file that could not be written
+};
+
+auto encodeTexture(const TextureView &texture, const ImageEncoder &encoder) -> OutputFile ;
+auto exportTextures(const TextureArchive &archive, const Options &options) -> ExportSummary ;
+
+#endif /* exporter_hpp */
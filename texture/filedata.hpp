@@ -0,0 +1,46 @@
+//
+
+#ifndef filedata_hpp
+#define filedata_hpp
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//==============================================================================================================================
+// FileData
+//==============================================================================================================================
+/*
+ The bytes of a complete file, as the encoders build them.  A std::vector value initializes (zero fills) every element
+ when it is sized, but an encoder is about to write every byte anyway, so for a whole file that is a memset for
+ nothing.  This allocator default initializes instead, which for bytes means the memory is left as it is.  Asking
+ for a value (resize(n, 0), or constructing from a range) still works the same as for any vector.
+ The allocator is also used for other buffers that are filled as soon as they are made (the pixels of a
+ DecodedTexture, see texturecache.hpp).
+ */
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = DefaultInitAllocator<U> ;
+    };
+    DefaultInitAllocator() = default ;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U> &) noexcept {
+    }
+    template <typename U>
+    auto construct(U *address) noexcept(std::is_nothrow_default_constructible_v<U>) -> void {
+        ::new(static_cast<void*>(address)) U ;
+    }
+    template <typename U, typename... Arguments>
+    auto construct(U *address, Arguments&&... arguments) -> void {
+        ::new(static_cast<void*>(address)) U(std::forward<Arguments>(arguments)...) ;
+    }
+};
+
+using FileData = std::vector<std::uint8_t, DefaultInitAllocator<std::uint8_t>> ;
+
+#endif /* filedata_hpp */
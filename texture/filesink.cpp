@@ -0,0 +1,567 @@
+//
+
+#include "filesink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "stats.hpp"
+
+#if !defined(_WIN32) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TEXTURE_HAVE_PWRITE 1
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define TEXTURE_HAVE_IO_URING 1
+#endif
+#endif
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    auto failure(const std::string &name, int error) -> std::string {
+        return name + ": "s + std::generic_category().message(error) ;
+    }
+    //==========================================================================================================================
+    // Whatever is left of a file that could not be written is removed (there may be nothing to remove, or it may
+    // be something that is not ours to remove, like a directory with that name)
+    auto discard(const std::string &name) -> void {
+        auto error = std::error_code() ;
+        if (std::filesystem::is_regular_file(name, error)) {
+            std::filesystem::remove(name, error);
+        }
+    }
+
+    //==========================================================================================================================
+    // StreamSink
+    //==========================================================================================================================
+    class StreamSink : public FileSink {
+    public:
+        auto backend() const -> WriteBackend override {
+            return WriteBackend::stream ;
+        }
+        auto depth() const -> std::size_t override {
+            return 1 ;
+        }
+        auto write(const std::vector<OutputFile> &files) -> std::vector<std::string> override {
+            auto errors = std::vector<std::string>(files.size()) ;
+            for (auto i = std::size_t(0) ; i < files.size() ; i++) {
+                // A stream does not say why it failed, but the system call under it usually leaves that in errno
+                errno = 0 ;
+                try {
+                    files[i].save();
+                }
+                catch(...) {
+                    errors[i] = (errno != 0 ? failure(files[i].name, errno) : files[i].name + ": the write failed"s) ;
+                    discard(files[i].name);
+                }
+            }
+            return errors ;
+        }
+    };
+
+#if defined(TEXTURE_HAVE_PWRITE)
+    //==========================================================================================================================
+    // PwriteSink
+    //==========================================================================================================================
+    // Create, write, and close one file.  Returns 0, or the errno of what went wrong.
+    auto writeWhole(const OutputFile &file) -> int {
+        auto fd = ::open(file.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666) ;
+        if (fd < 0) {
+            return errno ;
+        }
+        auto error = 0 ;
+        auto written = std::size_t(0) ;
+        while (written < file.data.size()) {
+            auto result = ::pwrite(fd, file.data.data() + written, file.data.size() - written, static_cast<off_t>(written)) ;
+            if (result < 0 && errno == EINTR) {
+                continue ;
+            }
+            if (result <= 0) {
+                error = (result < 0 ? errno : EIO) ;
+                break ;
+            }
+            written += static_cast<std::size_t>(result) ;
+        }
+        // The disk being full can first show up when the file is closed
+        if (::close(fd) != 0 && error == 0) {
+            error = errno ;
+        }
+        return error ;
+    }
+
+    // The threads are started once, and each batch is shared out between them a file at a time
+    class PwriteSink : public FileSink {
+        std::vector<std::thread> threads ;
+        std::mutex access ;
+        std::condition_variable started ;
+        std::condition_variable completed ;
+        const std::vector<OutputFile> *batch ;
+        std::vector<std::string> *errors ;
+        std::atomic<std::size_t> next ;
+        std::atomic<std::size_t> remaining ;
+        std::uint64_t generation ;  // Which batch it is, so a thread knows there is a new one
+        int busy ;  // Threads still working on the batch (the batch can not be let go until they are done with it)
+        bool stopping ;
+
+        auto work() -> void {
+            auto seen = std::uint64_t(0) ;
+            while (true) {
+                const std::vector<OutputFile> *files = nullptr ;
+                std::vector<std::string> *failures = nullptr ;
+                {
+                    auto lock = std::unique_lock<std::mutex>(access) ;
+                    started.wait(lock, [&]{ return stopping || generation != seen ;});
+                    if (stopping) {
+                        return ;
+                    }
+                    seen = generation ;
+                    if (batch == nullptr) {
+                        continue ;  // We woke too late, that batch is already done
+                    }
+                    files = batch ;
+                    failures = errors ;
+                    busy++ ;
+                }
+                for (auto index = next.fetch_add(1) ; index < files->size() ; index = next.fetch_add(1)) {
+                    const auto &file = (*files)[index] ;
+                    auto timer = StageTimer(Stage::write) ;
+                    auto error = writeWhole(file) ;
+                    timer.stop();
+                    if (error != 0) {
+                        (*failures)[index] = failure(file.name, error) ;
+                        discard(file.name);
+                    }
+                    else {
+                        Stats::add(Counter::filesWritten);
+                        Stats::add(Counter::bytesWritten, file.data.size());
+                    }
+                    remaining.fetch_sub(1);
+                }
+                {
+                    auto lock = std::lock_guard<std::mutex>(access) ;
+                    busy-- ;
+                }
+                completed.notify_all();
+            }
+        }
+    public:
+        explicit PwriteSink(std::size_t depth):batch(nullptr),errors(nullptr),next(0),remaining(0),generation(0),busy(0),stopping(false) {
+            auto count = std::clamp<std::size_t>(depth, 1, 16) ;
+            for (auto i = std::size_t(0) ; i < count ; i++) {
+                threads.emplace_back([this]{ work(); });
+            }
+        }
+        ~PwriteSink() override {
+            {
+                auto lock = std::lock_guard<std::mutex>(access) ;
+                stopping = true ;
+            }
+            started.notify_all();
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+        auto backend() const -> WriteBackend override {
+            return WriteBackend::pwrite ;
+        }
+        auto depth() const -> std::size_t override {
+            return threads.size() * 2 ;  // So a thread that finishes early has something to pick up
+        }
+        auto write(const std::vector<OutputFile> &files) -> std::vector<std::string> override {
+            auto result = std::vector<std::string>(files.size()) ;
+            if (files.empty()) {
+                return result ;
+            }
+            auto lock = std::unique_lock<std::mutex>(access) ;
+            batch = &files ;
+            errors = &result ;
+            next = 0 ;
+            remaining = files.size() ;
+            generation++ ;
+            started.notify_all();
+            completed.wait(lock, [&]{ return remaining.load() == 0 && busy == 0 ;});
+            batch = nullptr ;
+            errors = nullptr ;
+            return result ;
+        }
+    };
+#endif
+
+#if defined(TEXTURE_HAVE_IO_URING)
+    //==========================================================================================================================
+    // UringSink
+    //==========================================================================================================================
+    /*
+     io_uring is a pair of ring buffers shared with the kernel.  We put requests (submission queue entries) on one,
+     tell the kernel how many with io_uring_enter, and it puts a completion (with the result, what the system call
+     would have returned) on the other for each, as they finish.  The rings are memory mapped from the io_uring file
+     descriptor, and the head and tail of each are updated by one side, and read by the other (with acquire/release
+     ordering, so the entries themselves are seen before the index that says they are there).
+
+     Each file goes through: open, then write linked to close (a linked request only starts when the one before it
+     succeeds, otherwise it completes with ECANCELED).  A short write breaks the link too, so then the rest is written,
+     again linked to a close.  If anything fails, the file is closed on its own.  Every request carries the index of
+     the file and what it was in its user_data, so the completions can be matched back up.
+     */
+    constexpr auto openRequest = std::uint64_t(0) ;
+    constexpr auto writeRequest = std::uint64_t(1) ;
+    constexpr auto closeRequest = std::uint64_t(2) ;
+    constexpr auto maxWrite = std::size_t(1) << 30 ;  // The length of a request is 32 bits
+
+    class UringSink : public FileSink {
+        enum class Next {
+            open,
+            writeAndClose,
+            close
+        };
+        struct FileState {
+            int fd ;
+            std::size_t written ;
+            int error ;
+            bool opened ;
+            bool closed ;
+            int outstanding ;  // Requests in flight
+            std::chrono::steady_clock::time_point start ;
+        };
+        int ring ;
+        unsigned entries ;
+        void *sqRing ;
+        std::size_t sqRingSize ;
+        void *cqRing ;
+        std::size_t cqRingSize ;
+        io_uring_sqe *sqes ;
+        std::size_t sqesSize ;
+        unsigned *sqTail ;
+        unsigned *sqMask ;
+        unsigned *sqArray ;
+        unsigned *cqHead ;
+        unsigned *cqTail ;
+        unsigned *cqMask ;
+        io_uring_cqe *cqes ;
+
+        //======================================================================================================================
+        auto release() -> void {
+            if (sqes != nullptr) {
+                ::munmap(sqes, sqesSize);
+            }
+            if (cqRing != nullptr && cqRing != sqRing) {
+                ::munmap(cqRing, cqRingSize);
+            }
+            if (sqRing != nullptr) {
+                ::munmap(sqRing, sqRingSize);
+            }
+            if (ring >= 0) {
+                ::close(ring);
+            }
+        }
+        //======================================================================================================================
+        template <typename T>
+        static auto at(void *base, std::uint32_t offset) -> T* {
+            return reinterpret_cast<T*>(static_cast<std::uint8_t*>(base) + offset) ;
+        }
+        //======================================================================================================================
+        // The kernel may be new enough to have io_uring, but not these operations (they came in 5.6)
+        auto supported() -> bool {
+            constexpr auto opCount = 256 ;
+            auto buffer = std::vector<std::uint8_t>(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op), 0) ;
+            auto probe = reinterpret_cast<io_uring_probe*>(buffer.data()) ;
+            if (::syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, opCount) < 0) {
+                return false ;
+            }
+            for (auto op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE}) {
+                if (op > probe->last_op || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+        //======================================================================================================================
+        auto push(std::uint8_t opcode, int fd, const void *address, std::uint32_t length, std::uint64_t offset, std::uint64_t tag, std::uint8_t flags) -> void {
+            auto tail = *sqTail ;  // Only we change the tail
+            auto index = tail & *sqMask ;
+            auto &sqe = sqes[index] ;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode ;
+            sqe.fd = fd ;
+            sqe.addr = reinterpret_cast<std::uint64_t>(address) ;
+            sqe.len = length ;
+            sqe.off = offset ;
+            sqe.user_data = tag ;
+            sqe.flags = flags ;
+            if (opcode == IORING_OP_OPENAT) {
+                sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC ;
+            }
+            sqArray[index] = index ;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        }
+        //======================================================================================================================
+        // Hand over the requests not yet submitted, and wait for at least one completion.  inFlight counts every request
+        // we have not had the completion of, including the unsubmitted ones.
+        auto enter(unsigned &unsubmitted, unsigned inFlight) -> void {
+            while (true) {
+                // With nothing in flight, nothing would ever complete, so we must not wait
+                auto wait = (inFlight > 0 ? 1u : 0u) ;
+                auto result = ::syscall(__NR_io_uring_enter, ring, unsubmitted, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0) ;
+                if (result >= 0) {
+                    unsubmitted -= static_cast<unsigned>(result) ;
+                    return ;
+                }
+                if (errno == EINTR) {
+                    continue ;
+                }
+                if (errno == EAGAIN || errno == EBUSY) {
+                    // The kernel is short of room for now.  If it has some of ours, wait for one of those to finish
+                    // (which frees some), otherwise there is nothing to wait for, so just try again.
+                    auto submitted = inFlight - unsubmitted ;
+                    if (submitted > 0) {
+                        auto none = 0u ;
+                        enter(none, submitted);
+                        return ;
+                    }
+                    std::this_thread::yield();
+                    continue ;
+                }
+                throw std::runtime_error("io_uring_enter failed: "s + std::generic_category().message(errno));
+            }
+        }
+    public:
+        explicit UringSink(std::size_t depth):ring(-1),entries(0),sqRing(nullptr),sqRingSize(0),cqRing(nullptr),cqRingSize(0),sqes(nullptr),sqesSize(0) {
+            auto params = io_uring_params{} ;
+            ring = static_cast<int>(::syscall(__NR_io_uring_setup, static_cast<unsigned>(std::clamp<std::size_t>(depth, 2, 4096)), &params)) ;
+            if (ring < 0) {
+                throw std::runtime_error("io_uring is not available: "s + std::generic_category().message(errno));
+            }
+            entries = params.sq_entries ;
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned) ;
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe) ;
+            auto single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0 ;
+            if (single) {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize) ;
+            }
+            auto mapping = [this](std::size_t size, off_t offset) -> void* {
+                auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset) ;
+                return address == MAP_FAILED ? nullptr : address ;
+            };
+            sqRing = mapping(sqRingSize, IORING_OFF_SQ_RING) ;
+            cqRing = (single ? sqRing : mapping(cqRingSize, IORING_OFF_CQ_RING)) ;
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe) ;
+            sqes = static_cast<io_uring_sqe*>(mapping(sqesSize, IORING_OFF_SQES)) ;
+            if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr || !supported()) {
+                release();
+                throw std::runtime_error("io_uring is not available: the kernel does not support what we need"s);
+            }
+            sqTail = at<unsigned>(sqRing, params.sq_off.tail) ;
+            sqMask = at<unsigned>(sqRing, params.sq_off.ring_mask) ;
+            sqArray = at<unsigned>(sqRing, params.sq_off.array) ;
+            cqHead = at<unsigned>(cqRing, params.cq_off.head) ;
+            cqTail = at<unsigned>(cqRing, params.cq_off.tail) ;
+            cqMask = at<unsigned>(cqRing, params.cq_off.ring_mask) ;
+            cqes = at<io_uring_cqe>(cqRing, params.cq_off.cqes) ;
+        }
+        ~UringSink() override {
+            release();
+        }
+        UringSink(const UringSink &) = delete ;
+        auto operator=(const UringSink &) -> UringSink& = delete ;
+        auto backend() const -> WriteBackend override {
+            return WriteBackend::uring ;
+        }
+        auto depth() const -> std::size_t override {
+            return entries ;
+        }
+        //======================================================================================================================
+        auto write(const std::vector<OutputFile> &files) -> std::vector<std::string> override {
+            auto errors = std::vector<std::string>(files.size()) ;
+            auto states = std::vector<FileState>(files.size(), FileState{-1, 0, 0, false, false, 0, {}}) ;
+            auto ready = std::deque<std::pair<std::size_t, Next>>() ;
+            for (auto i = std::size_t(0) ; i < files.size() ; i++) {
+                ready.emplace_back(i, Next::open);
+            }
+            auto finished = std::size_t(0) ;
+            auto inFlight = 0u ;
+            auto unsubmitted = 0u ;
+            // Once a file has nothing in flight, decide what it needs next
+            auto advance = [&](std::size_t i) {
+                auto &state = states[i] ;
+                const auto &file = files[i] ;
+                if (state.opened && !state.closed) {
+                    if (state.error != 0 || state.written == file.data.size()) {
+                        ready.emplace_back(i, Next::close);
+                    }
+                    else {
+                        ready.emplace_back(i, Next::writeAndClose);
+                    }
+                    return ;
+                }
+                // Either the open failed, or it has been closed, so it is done
+                if (state.error == 0 && state.written < file.data.size()) {
+                    state.error = EIO ;
+                }
+                finished++ ;
+                if (state.error != 0) {
+                    errors[i] = failure(file.name, state.error) ;
+                    if (state.opened) {
+                        discard(file.name);
+                    }
+                }
+                else {
+                    Stats::add(Counter::filesWritten);
+                    Stats::add(Counter::bytesWritten, file.data.size());
+                }
+                if (Stats::enabled()) {
+                    Stats::record(Stage::write, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state.start));
+                }
+            };
+            while (finished < files.size()) {
+                while (!ready.empty()) {
+                    auto [i, next] = ready.front() ;
+                    auto count = (next == Next::writeAndClose ? 2u : 1u) ;
+                    if (inFlight + count > entries) {
+                        break ;
+                    }
+                    ready.pop_front();
+                    auto &state = states[i] ;
+                    const auto &file = files[i] ;
+                    auto tag = static_cast<std::uint64_t>(i) << 2 ;
+                    if (next == Next::open) {
+                        state.start = std::chrono::steady_clock::now() ;
+                        push(IORING_OP_OPENAT, AT_FDCWD, file.name.c_str(), 0666, 0, tag | openRequest, 0);
+                    }
+                    else if (next == Next::writeAndClose) {
+                        auto length = std::min(file.data.size() - state.written, maxWrite) ;
+                        push(IORING_OP_WRITE, state.fd, file.data.data() + state.written, static_cast<std::uint32_t>(length), state.written, tag | writeRequest, IOSQE_IO_LINK);
+                        push(IORING_OP_CLOSE, state.fd, nullptr, 0, 0, tag | closeRequest, 0);
+                    }
+                    else {
+                        push(IORING_OP_CLOSE, state.fd, nullptr, 0, 0, tag | closeRequest, 0);
+                    }
+                    state.outstanding += static_cast<int>(count) ;
+                    inFlight += count ;
+                    unsubmitted += count ;
+                }
+                enter(unsubmitted, inFlight);
+                auto head = *cqHead ;  // Only we change the head
+                auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) ;
+                while (head != tail) {
+                    const auto &cqe = cqes[head & *cqMask] ;
+                    auto i = static_cast<std::size_t>(cqe.user_data >> 2) ;
+                    auto &state = states[i] ;
+                    switch (cqe.user_data & 3) {
+                        case openRequest:
+                            if (cqe.res < 0) {
+                                state.error = -cqe.res ;
+                            }
+                            else {
+                                state.fd = cqe.res ;
+                                state.opened = true ;
+                            }
+                            break ;
+                        case writeRequest:
+                            if (cqe.res < 0) {
+                                state.error = -cqe.res ;
+                            }
+                            else if (cqe.res == 0) {
+                                state.error = EIO ;  // Nothing written, and no reason why, so we would loop forever
+                            }
+                            else {
+                                state.written += static_cast<std::size_t>(cqe.res) ;
+                            }
+                            break ;
+                        default:
+                            if (cqe.res != -ECANCELED) {
+                                // Even if close fails, the descriptor is gone
+                                state.closed = true ;
+                                if (cqe.res < 0 && state.error == 0) {
+                                    state.error = -cqe.res ;
+                                }
+                            }
+                            break ;
+                    }
+                    head++ ;
+                    inFlight-- ;
+                    if (--state.outstanding == 0) {
+                        advance(i);
+                    }
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            }
+            return errors ;
+        }
+    };
+#endif
+}
+
+//==============================================================================================================================
+// FileSink
+//==============================================================================================================================
+//==============================================================================================================================
+auto writeBackendName(WriteBackend backend) -> const char* {
+    switch (backend) {
+        case WriteBackend::automatic:
+            return "auto" ;
+        case WriteBackend::uring:
+            return "uring" ;
+        case WriteBackend::pwrite:
+            return "pwrite" ;
+        case WriteBackend::stream:
+            return "stream" ;
+    }
+    return "unknown" ;
+}
+//==============================================================================================================================
+auto FileSink::create(WriteBackend backend, std::size_t depth) -> std::unique_ptr<FileSink> {
+    switch (backend) {
+        case WriteBackend::automatic:
+#if defined(TEXTURE_HAVE_IO_URING)
+            try {
+                return std::make_unique<UringSink>(depth) ;
+            }
+            catch(...) {
+                // Turned off (or not allowed, as in some containers), so use the next best
+            }
+#endif
+#if defined(TEXTURE_HAVE_PWRITE)
+            return std::make_unique<PwriteSink>(depth) ;
+#else
+            return std::make_unique<StreamSink>() ;
+#endif
+        case WriteBackend::uring:
+#if defined(TEXTURE_HAVE_IO_URING)
+            return std::make_unique<UringSink>(depth) ;
+#else
+            throw std::runtime_error("io_uring is not available on this platform"s);
+#endif
+        case WriteBackend::pwrite:
+#if defined(TEXTURE_HAVE_PWRITE)
+            return std::make_unique<PwriteSink>(depth) ;
+#else
+            throw std::runtime_error("pwrite is not available on this platform"s);
+#endif
+        case WriteBackend::stream:
+            return std::make_unique<StreamSink>() ;
+    }
+    throw std::runtime_error("Unknown write backend"s);
+}
@@ -0,0 +1,55 @@
+//
+
+#ifndef filesink_hpp
+#define filesink_hpp
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "outputwriter.hpp"
+
+//==============================================================================================================================
+// FileSink
+//==============================================================================================================================
+/*
+ Writes batches of complete files (each one created, written, and closed).  Writing one small file at a time, and
+ waiting for each call to finish before making the next, leaves a fast disk mostly idle: the time goes to the calls,
+ not the data.  Given a whole batch at once, a sink can keep many of the operations in flight together.
+
+    uring       Linux io_uring (made with the raw system calls, no liburing needed).  The opens for the whole batch
+                are put on the submission queue and handed to the kernel with one call, then each file's write and
+                close (linked, so the close starts when the write is done), again all at once.  Up to "depth"
+                operations are in flight at a time.
+    pwrite      A few threads of our own, each doing open/pwrite/close for its share of the batch (the depth is the
+                number of threads, up to 16).  For unix systems without io_uring (or where it is turned off).
+    stream      One file at a time with std::ofstream (OutputFile::save).  What windows uses.
+ automatic picks the first of those the system has.
+
+ Each file either succeeds, or gets an error message (an unwritable directory, a full disk, ...).  One file failing
+ does not stop the rest of the batch.  A file that failed part way through is removed, so it is not mistaken for
+ a good one later.
+ */
+enum class WriteBackend {
+    automatic,
+    uring,
+    pwrite,
+    stream
+};
+
+auto writeBackendName(WriteBackend backend) -> const char* ;
+
+class FileSink {
+public:
+    virtual ~FileSink() = default ;
+    virtual auto backend() const -> WriteBackend = 0 ;
+    // The most files it is worth handing over at once
+    virtual auto depth() const -> std::size_t = 0 ;
+    // Write every file, and return, for each, an empty string if it was written, or why it was not
+    virtual auto write(const std::vector<OutputFile> &files) -> std::vector<std::string> = 0 ;
+
+    // Throws if the backend asked for (other than automatic) is not available here
+    static auto create(WriteBackend backend, std::size_t depth) -> std::unique_ptr<FileSink> ;
+};
+
+#endif /* filesink_hpp */
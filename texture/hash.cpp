@@ -0,0 +1,123 @@
+//
+
+#include "hash.hpp"
+
+#include <array>
+#include <cstring>
+
+//======================================================================
+namespace {
+    constexpr auto prime1 = std::uint64_t(11400714785074694791ULL) ;
+    constexpr auto prime2 = std::uint64_t(14029467366897019727ULL) ;
+    constexpr auto prime3 = std::uint64_t(1609587929392839161ULL) ;
+    constexpr auto prime4 = std::uint64_t(9650029242287828579ULL) ;
+    constexpr auto prime5 = std::uint64_t(2870177450012600261ULL) ;
+
+    //==========================================================================================================================
+    // The CRC-32 of every byte value, built at compile time
+    constexpr auto crcTable() -> std::array<std::uint32_t,256> {
+        auto table = std::array<std::uint32_t,256>{} ;
+        for (auto value = std::uint32_t(0) ; value < 256 ; value++) {
+            auto crc = value ;
+            for (auto bit = 0 ; bit < 8 ; bit++) {
+                crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1 ;
+            }
+            table[value] = crc ;
+        }
+        return table ;
+    }
+    constexpr auto crcValues = crcTable() ;
+
+    //==========================================================================================================================
+    inline auto rotateLeft(std::uint64_t value, int bits) -> std::uint64_t {
+        return (value << bits) | (value >> (64 - bits)) ;
+    }
+    //==========================================================================================================================
+    // The data is little endian (as is everything else in these files), we use memcpy as it may not be aligned
+    inline auto read64(const std::uint8_t *data) -> std::uint64_t {
+        auto value = std::uint64_t(0) ;
+        std::memcpy(&value, data, 8) ;
+        return value ;
+    }
+    //==========================================================================================================================
+    inline auto read32(const std::uint8_t *data) -> std::uint32_t {
+        auto value = std::uint32_t(0) ;
+        std::memcpy(&value, data, 4) ;
+        return value ;
+    }
+    //==========================================================================================================================
+    inline auto round(std::uint64_t accumulator, std::uint64_t input) -> std::uint64_t {
+        accumulator += input * prime2 ;
+        accumulator = rotateLeft(accumulator, 31) ;
+        return accumulator * prime1 ;
+    }
+    //==========================================================================================================================
+    inline auto merge(std::uint64_t hash, std::uint64_t accumulator) -> std::uint64_t {
+        hash ^= round(0, accumulator) ;
+        return hash * prime1 + prime4 ;
+    }
+}
+
+//==============================================================================================================================
+auto hash64(const void *data, std::size_t length, std::uint64_t seed) -> std::uint64_t {
+    auto input = static_cast<const std::uint8_t*>(data) ;
+    auto end = input + length ;
+    auto hash = std::uint64_t(0) ;
+    if (length >= 32) {
+        // The four lanes
+        auto v1 = seed + prime1 + prime2 ;
+        auto v2 = seed + prime2 ;
+        auto v3 = seed ;
+        auto v4 = seed - prime1 ;
+        auto limit = end - 32 ;
+        do {
+            v1 = round(v1, read64(input)) ;
+            v2 = round(v2, read64(input + 8)) ;
+            v3 = round(v3, read64(input + 16)) ;
+            v4 = round(v4, read64(input + 24)) ;
+            input += 32 ;
+        } while (input <= limit) ;
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18) ;
+        hash = merge(hash, v1) ;
+        hash = merge(hash, v2) ;
+        hash = merge(hash, v3) ;
+        hash = merge(hash, v4) ;
+    }
+    else {
+        hash = seed + prime5 ;
+    }
+    hash += static_cast<std::uint64_t>(length) ;
+    // Whatever is left, less than 32 bytes
+    while (input + 8 <= end) {
+        hash ^= round(0, read64(input)) ;
+        hash = rotateLeft(hash, 27) * prime1 + prime4 ;
+        input += 8 ;
+    }
+    if (input + 4 <= end) {
+        hash ^= static_cast<std::uint64_t>(read32(input)) * prime1 ;
+        hash = rotateLeft(hash, 23) * prime2 + prime3 ;
+        input += 4 ;
+    }
+    while (input < end) {
+        hash ^= static_cast<std::uint64_t>(*input) * prime5 ;
+        hash = rotateLeft(hash, 11) * prime1 ;
+        input++ ;
+    }
+    // Mix the bits, so every input bit affects every output bit
+    hash ^= hash >> 33 ;
+    hash *= prime2 ;
+    hash ^= hash >> 29 ;
+    hash *= prime3 ;
+    hash ^= hash >> 32 ;
+    return hash ;
+}
+
+//==============================================================================================================================
+auto crc32(const void *data, std::size_t length, std::uint32_t crc) -> std::uint32_t {
+    auto input = static_cast<const std::uint8_t*>(data) ;
+    crc = ~crc ;
+    for (auto i = std::size_t(0) ; i < length ; i++) {
+        crc = crcValues[(crc ^ input[i]) & 0xFF] ^ (crc >> 8) ;
+    }
+    return ~crc ;
+}
@@ -0,0 +1,30 @@
+//
+
+#ifndef hash_hpp
+#define hash_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================================================================
+// hash64
+//==============================================================================================================================
+/*
+ A fast, non cryptographic, 64 bit hash of a block of memory.  This is the XXH64 algorithm
+ (https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md), so the values match any other XXH64 implementation.
+ The bulk of the data is consumed 32 bytes at a time into four independent accumulators, which lets the processor
+ work on all four at once, and runs at close to memory speed.
+ It is good for telling if two blocks are (almost certainly) the same, not for anything security related.
+ */
+auto hash64(const void *data, std::size_t length, std::uint64_t seed = 0) -> std::uint64_t ;
+
+//==============================================================================================================================
+// crc32
+//==============================================================================================================================
+/*
+ The CRC-32 checksum (the one zip, PNG, and zlib's crc32 use), one byte at a time from a table.
+ To checksum data that arrives in pieces, pass the result of the previous piece as crc.
+ */
+auto crc32(const void *data, std::size_t length, std::uint32_t crc = 0) -> std::uint32_t ;
+
+#endif /* hash_hpp */
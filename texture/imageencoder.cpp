@@ -0,0 +1,324 @@
+//
+
+#include "imageencoder.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "bmproutine.hpp"
+#include "colorconvert.hpp"
+#include "deflate.hpp"
+#include "hash.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    auto putBigEndian(FileData &buffer, std::uint32_t value) -> void {
+        for (auto shift = 24 ; shift >= 0 ; shift -= 8) {
+            buffer.push_back(static_cast<std::uint8_t>((value >> shift) & 0xFF));
+        }
+    }
+    //==========================================================================================================================
+    auto checkImage(int width, int height, int depth) -> void {
+        if (width <= 0 || height <= 0) {
+            throw std::runtime_error("Invalid image size: "s + std::to_string(width) + "x"s + std::to_string(height));
+        }
+        if (depth != 16 && depth != 24 && depth != 32) {
+            throw std::runtime_error("Unsupported color depth: "s + std::to_string(depth));
+        }
+    }
+
+    //==========================================================================================================================
+    // PNG
+    //==========================================================================================================================
+    // Start a chunk (the length is filled in by endChunk, once we know it), and return where it starts
+    auto startChunk(FileData &buffer, const char *type) -> std::size_t {
+        auto start = buffer.size() ;
+        putBigEndian(buffer, 0) ;
+        buffer.insert(buffer.end(), type, type + 4);
+        return start ;
+    }
+    //==========================================================================================================================
+    auto endChunk(FileData &buffer, std::size_t start) -> void {
+        auto length = static_cast<std::uint32_t>(buffer.size() - start - 8) ;
+        for (auto i = 0 ; i < 4 ; i++) {
+            buffer[start + static_cast<std::size_t>(i)] = static_cast<std::uint8_t>((length >> (24 - 8 * i)) & 0xFF) ;
+        }
+        putBigEndian(buffer, crc32(buffer.data() + start + 4, length + 4)) ;
+    }
+    //==========================================================================================================================
+    // The Paeth predictor: whichever of left, above, or above left is closest to left + above - above left
+    inline auto paeth(int left, int above, int aboveLeft) -> int {
+        auto estimate = left + above - aboveLeft ;
+        auto toLeft = std::abs(estimate - left) ;
+        auto toAbove = std::abs(estimate - above) ;
+        auto toAboveLeft = std::abs(estimate - aboveLeft) ;
+        if (toLeft <= toAbove && toLeft <= toAboveLeft) {
+            return left ;
+        }
+        return toAbove <= toAboveLeft ? above : aboveLeft ;
+    }
+    //==========================================================================================================================
+    // Filter the row with the given filter type (0 = none, 1 = sub, 2 = up, 3 = average, 4 = paeth), returning the
+    // sum of the filtered bytes taken as signed values (the usual guess at how well it will compress, smaller is better)
+    auto filterRow(int type, const std::uint8_t *row, const std::uint8_t *above, std::size_t length, std::size_t bpp, std::uint8_t *output) -> std::size_t {
+        auto sum = std::size_t(0) ;
+        for (auto i = std::size_t(0) ; i < length ; i++) {
+            auto left = (i >= bpp ? row[i - bpp] : 0) ;
+            auto up = static_cast<int>(above[i]) ;
+            auto upLeft = (i >= bpp ? above[i - bpp] : 0) ;
+            auto predicted = 0 ;
+            switch (type) {
+                case 1:
+                    predicted = left ;
+                    break ;
+                case 2:
+                    predicted = up ;
+                    break ;
+                case 3:
+                    predicted = (left + up) / 2 ;
+                    break ;
+                case 4:
+                    predicted = paeth(left, up, upLeft) ;
+                    break ;
+                default:
+                    break ;
+            }
+            auto value = static_cast<std::uint8_t>(row[i] - predicted) ;
+            output[i] = value ;
+            sum += static_cast<std::size_t>(std::abs(static_cast<int>(static_cast<std::int8_t>(value)))) ;
+        }
+        return sum ;
+    }
+
+    //==========================================================================================================================
+    // QOI
+    //==========================================================================================================================
+    constexpr auto qoiIndex = std::uint8_t(0x00) ;
+    constexpr auto qoiDiff = std::uint8_t(0x40) ;
+    constexpr auto qoiLuma = std::uint8_t(0x80) ;
+    constexpr auto qoiRun = std::uint8_t(0xC0) ;
+    constexpr auto qoiRgb = std::uint8_t(0xFE) ;
+    constexpr auto qoiRgba = std::uint8_t(0xFF) ;
+
+    struct QoiPixel {
+        std::uint8_t red ;
+        std::uint8_t green ;
+        std::uint8_t blue ;
+        std::uint8_t alpha ;
+        auto operator==(const QoiPixel &other) const -> bool {
+            return red == other.red && green == other.green && blue == other.blue && alpha == other.alpha ;
+        }
+        auto hash() const -> std::size_t {
+            return (static_cast<std::size_t>(red) * 3 + static_cast<std::size_t>(green) * 5 + static_cast<std::size_t>(blue) * 7 + static_cast<std::size_t>(alpha) * 11) % 64 ;
+        }
+    };
+}
+
+//==============================================================================================================================
+// ImageFormat
+//==============================================================================================================================
+//==============================================================================================================================
+auto imageFormatName(ImageFormat format) -> const char* {
+    switch (format) {
+        case ImageFormat::qoi:
+            return "qoi" ;
+        case ImageFormat::png:
+            return "png" ;
+        default:
+            return "bmp" ;
+    }
+}
+
+//==============================================================================================================================
+// ImageEncoder
+//==============================================================================================================================
+//==============================================================================================================================
+auto ImageEncoder::extension() const -> std::string {
+    return "."s + imageFormatName(format()) ;
+}
+//==============================================================================================================================
+auto ImageEncoder::create(ImageFormat format, int depth, int level) -> std::unique_ptr<ImageEncoder> {
+    switch (format) {
+        case ImageFormat::qoi:
+            return std::make_unique<QoiImageEncoder>(depth) ;
+        case ImageFormat::png:
+            return std::make_unique<PngImageEncoder>(depth, level) ;
+        default:
+            return std::make_unique<BmpImageEncoder>(depth) ;
+    }
+}
+
+//==============================================================================================================================
+// BmpImageEncoder
+//==============================================================================================================================
+//==============================================================================================================================
+BmpImageEncoder::BmpImageEncoder(int depth):depth(depth) {
+    checkImage(1, 1, depth);
+}
+//==============================================================================================================================
+auto BmpImageEncoder::format() const -> ImageFormat {
+    return ImageFormat::bmp ;
+}
+//==============================================================================================================================
+auto BmpImageEncoder::encode(const std::uint16_t *pixels, int width, int height) const -> FileData {
+    // The whole file (headers, then the rows converted to the depth we want, and flipped to be bottom row first) is built
+    // in one buffer.  See BmpEncoder in bmproutine.hpp
+    return encodeBmp(pixels, width, height, depth) ;
+}
+
+//==============================================================================================================================
+// QoiImageEncoder
+//==============================================================================================================================
+//==============================================================================================================================
+QoiImageEncoder::QoiImageEncoder(int depth):depth(depth) {
+    checkImage(1, 1, depth);
+}
+//==============================================================================================================================
+auto QoiImageEncoder::format() const -> ImageFormat {
+    return ImageFormat::qoi ;
+}
+//==============================================================================================================================
+auto QoiImageEncoder::encode(const std::uint16_t *pixels, int width, int height) const -> FileData {
+    checkImage(width, height, depth);
+    auto count = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) ;
+    auto channels = (depth == 32 ? 4 : 3) ;
+    auto buffer = FileData() ;
+    // Most pixels take one or two bytes, this saves growing the buffer in most cases
+    buffer.reserve(22 + count * 2) ;
+    buffer.insert(buffer.end(), {'q', 'o', 'i', 'f'});
+    putBigEndian(buffer, static_cast<std::uint32_t>(width)) ;
+    putBigEndian(buffer, static_cast<std::uint32_t>(height)) ;
+    buffer.push_back(static_cast<std::uint8_t>(channels)) ;
+    buffer.push_back(0) ;
+
+    auto seen = std::array<QoiPixel,64>{} ;
+    auto last = QoiPixel{0, 0, 0, 255} ;
+    auto run = 0 ;
+    auto row = std::vector<std::uint8_t>(static_cast<std::size_t>(width) * 4) ;
+    for (auto line = 0 ; line < height ; line++) {
+        // Always converted with alpha, and for RGB the alpha is then ignored (every pixel is opaque)
+        convertRow(pixels + static_cast<std::size_t>(line) * static_cast<std::size_t>(width), width, 32, ChannelOrder::rgb, row.data()) ;
+        for (auto x = 0 ; x < width ; x++) {
+            auto rgba = row.data() + static_cast<std::size_t>(x) * 4 ;
+            auto pixel = QoiPixel{rgba[0], rgba[1], rgba[2], (channels == 4 ? rgba[3] : std::uint8_t(255))} ;
+            if (pixel == last) {
+                run++ ;
+                if (run == 62) {
+                    buffer.push_back(static_cast<std::uint8_t>(qoiRun | (run - 1))) ;
+                    run = 0 ;
+                }
+                continue ;
+            }
+            if (run > 0) {
+                buffer.push_back(static_cast<std::uint8_t>(qoiRun | (run - 1))) ;
+                run = 0 ;
+            }
+            auto slot = pixel.hash() ;
+            if (seen[slot] == pixel) {
+                buffer.push_back(static_cast<std::uint8_t>(qoiIndex | slot)) ;
+            }
+            else {
+                seen[slot] = pixel ;
+                if (pixel.alpha == last.alpha) {
+                    // The differences wrap around, as they are stored as bytes
+                    auto red = static_cast<int>(static_cast<std::int8_t>(pixel.red - last.red)) ;
+                    auto green = static_cast<int>(static_cast<std::int8_t>(pixel.green - last.green)) ;
+                    auto blue = static_cast<int>(static_cast<std::int8_t>(pixel.blue - last.blue)) ;
+                    auto redGreen = red - green ;
+                    auto blueGreen = blue - green ;
+                    if (red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1) {
+                        buffer.push_back(static_cast<std::uint8_t>(qoiDiff | ((red + 2) << 4) | ((green + 2) << 2) | (blue + 2))) ;
+                    }
+                    else if (green >= -32 && green <= 31 && redGreen >= -8 && redGreen <= 7 && blueGreen >= -8 && blueGreen <= 7) {
+                        buffer.push_back(static_cast<std::uint8_t>(qoiLuma | (green + 32))) ;
+                        buffer.push_back(static_cast<std::uint8_t>(((redGreen + 8) << 4) | (blueGreen + 8))) ;
+                    }
+                    else {
+                        buffer.insert(buffer.end(), {qoiRgb, pixel.red, pixel.green, pixel.blue});
+                    }
+                }
+                else {
+                    buffer.insert(buffer.end(), {qoiRgba, pixel.red, pixel.green, pixel.blue, pixel.alpha});
+                }
+            }
+            last = pixel ;
+        }
+    }
+    if (run > 0) {
+        buffer.push_back(static_cast<std::uint8_t>(qoiRun | (run - 1))) ;
+    }
+    buffer.insert(buffer.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return buffer ;
+}
+
+//==============================================================================================================================
+// PngImageEncoder
+//==============================================================================================================================
+//==============================================================================================================================
+PngImageEncoder::PngImageEncoder(int depth, int level):depth(depth),level(level) {
+    checkImage(1, 1, depth);
+    if (level < 0 || level > 9) {
+        throw std::runtime_error("Invalid compression level: "s + std::to_string(level));
+    }
+}
+//==============================================================================================================================
+auto PngImageEncoder::format() const -> ImageFormat {
+    return ImageFormat::png ;
+}
+//==============================================================================================================================
+auto PngImageEncoder::encode(const std::uint16_t *pixels, int width, int height) const -> FileData {
+    checkImage(width, height, depth);
+    auto bpp = static_cast<std::size_t>(depth == 32 ? 4 : 3) ;
+    auto rowBytes = static_cast<std::size_t>(width) * bpp ;
+    auto buffer = FileData() ;
+    buffer.reserve(64 + rowBytes * static_cast<std::size_t>(height) / 2) ;
+    buffer.insert(buffer.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+
+    auto chunk = startChunk(buffer, "IHDR") ;
+    putBigEndian(buffer, static_cast<std::uint32_t>(width)) ;
+    putBigEndian(buffer, static_cast<std::uint32_t>(height)) ;
+    buffer.push_back(8) ;  // Bits per channel
+    buffer.push_back(depth == 32 ? 6 : 2) ;  // Color type: RGBA or RGB
+    buffer.push_back(0) ;  // Compression (deflate)
+    buffer.push_back(0) ;  // Filter method (the five adaptive filters)
+    buffer.push_back(0) ;  // No interlace
+    endChunk(buffer, chunk);
+
+    // The compressed rows go straight into the IDAT chunk, as they are made.  Only this row, the one above it, and the
+    // filtered versions of it are kept.
+    chunk = startChunk(buffer, "IDAT") ;
+    {
+        auto stream = DeflateStream(buffer, level) ;
+        auto row = std::vector<std::uint8_t>(rowBytes) ;
+        auto above = std::vector<std::uint8_t>(rowBytes, 0) ;
+        auto best = std::vector<std::uint8_t>(rowBytes + 1) ;
+        auto trial = std::vector<std::uint8_t>(rowBytes + 1) ;
+        for (auto line = 0 ; line < height ; line++) {
+            convertRow(pixels + static_cast<std::size_t>(line) * static_cast<std::size_t>(width), width, (depth == 32 ? 32 : 24), ChannelOrder::rgb, row.data()) ;
+            // With no compression, filtering gains nothing, so it is not done
+            best[0] = 0 ;
+            auto bestSum = filterRow(0, row.data(), above.data(), rowBytes, bpp, best.data() + 1) ;
+            for (auto type = 1 ; type <= 4 && level > 0 ; type++) {
+                auto sum = filterRow(type, row.data(), above.data(), rowBytes, bpp, trial.data() + 1) ;
+                if (sum < bestSum) {
+                    trial[0] = static_cast<std::uint8_t>(type) ;
+                    std::swap(best, trial);
+                    bestSum = sum ;
+                }
+            }
+            stream.write(best.data(), best.size());
+            std::swap(row, above);
+        }
+        stream.finish();
+    }
+    endChunk(buffer, chunk);
+
+    chunk = startChunk(buffer, "IEND") ;
+    endChunk(buffer, chunk);
+    return buffer ;
+}
@@ -0,0 +1,105 @@
+//
+
+#ifndef imageencoder_hpp
+#define imageencoder_hpp
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "filedata.hpp"
+
+//======================================================================
+/* Image encoders
+ The export turns 0555 pixels (top row first, see texturearchive.hpp) into image files.  How it does that is up to an
+ ImageEncoder, so the rest of the export does not care which file format is written.  There are three:
+
+ BMP   Uncompressed, what the program has always written (see bmproutine.hpp).  16, 24, or 32 bits per pixel.
+
+ QOI   The "Quite OK Image" format (https://qoiformat.org/qoi-specification.pdf).  A simple, very fast, lossless
+       format, that usually gets close to PNG's size.  All values big endian.
+       Offset      Size        Purpose
+       0           4 bytes     'qoif'
+       4           4 bytes     Width
+       8           4 bytes     Height
+       12          1 byte      Channels (3 = RGB, 4 = RGBA)
+       13          1 byte      Color space (0 = sRGB with linear alpha)
+       14          ...         The pixels, left to right, top to bottom, each one coded as one of:
+                                   a run of the previous pixel (1-62 times)
+                                   an index into a table of 64 recently seen pixels (by a hash of the pixel)
+                                   a small difference from the previous pixel (in 1 or 2 bytes)
+                                   the full RGB or RGBA values
+       end         8 bytes     7 bytes of 0, then a 1
+
+ PNG   Portable Network Graphics (https://www.w3.org/TR/png/).  A signature, then "chunks" (4 byte length, 4 byte type,
+       the data, and a CRC-32 of the type and data).  We write IHDR (the size, 8 bits per channel, RGB or RGBA), one
+       IDAT (the rows, each with a filter byte in front, compressed as one zlib stream, see deflate.hpp), and IEND.
+       Each row is filtered (stored as the difference from the pixel to the left, the row above, ...) with the filter
+       that gives the smallest differences, which makes it compress better.
+
+ QOI and PNG have no 16 bit form, so for them depth 16 and 24 both mean RGB, and 32 means RGBA (with "no color"
+ transparent).  The compression level (0-9) only matters to PNG.
+ Both of those work through the pixels a row at a time (converting a row, then coding it), so other than the
+ finished file, nothing the size of the whole image is made.
+ */
+
+//==============================================================================================================================
+// ImageFormat
+//==============================================================================================================================
+enum class ImageFormat {
+    bmp,
+    qoi,
+    png
+};
+
+auto imageFormatName(ImageFormat format) -> const char* ;  // Also the file extension (without the ".")
+
+//==============================================================================================================================
+// ImageEncoder
+//==============================================================================================================================
+class ImageEncoder {
+public:
+    virtual ~ImageEncoder() = default ;
+    virtual auto format() const -> ImageFormat = 0 ;
+    // The complete file, for an image of 0555 pixels, top row first.  Safe to call from several threads at once.
+    virtual auto encode(const std::uint16_t *pixels, int width, int height) const -> FileData = 0 ;
+    auto extension() const -> std::string ;  // ".bmp", ...
+    static auto create(ImageFormat format, int depth, int level) -> std::unique_ptr<ImageEncoder> ;
+};
+
+//==============================================================================================================================
+// BmpImageEncoder
+//==============================================================================================================================
+class BmpImageEncoder : public ImageEncoder {
+    int depth ;
+public:
+    explicit BmpImageEncoder(int depth) ;
+    auto format() const -> ImageFormat override ;
+    auto encode(const std::uint16_t *pixels, int width, int height) const -> FileData override ;
+};
+
+//==============================================================================================================================
+// QoiImageEncoder
+//==============================================================================================================================
+class QoiImageEncoder : public ImageEncoder {
+    int depth ;
+public:
+    explicit QoiImageEncoder(int depth) ;
+    auto format() const -> ImageFormat override ;
+    auto encode(const std::uint16_t *pixels, int width, int height) const -> FileData override ;
+};
+
+//==============================================================================================================================
+// PngImageEncoder
+//==============================================================================================================================
+class PngImageEncoder : public ImageEncoder {
+    int depth ;
+    int level ;
+public:
+    PngImageEncoder(int depth, int level) ;
+    auto format() const -> ImageFormat override ;
+    auto encode(const std::uint16_t *pixels, int width, int height) const -> FileData override ;
+};
+
+#endif /* imageencoder_hpp */
@@ -12,8 +12,12 @@
 #include <string> // We use std::string
 #include <vector>  // This includes the "vector" container.  We will store our data that we read from the uo file in a vector
 
-// We include our bmp structures we will use
-#include "bmproutine.hpp"  // Note the use "" versuse <>.  This indicates a "user" supplied header versuse system, and the search order is different.
+// We include our own routines we will use
+#include "exporter.hpp"  // Note the use "" versuse <>.  This indicates a "user" supplied header versuse system, and the search order is different.
+#include "options.hpp" // The command line options
+#include "packer.hpp" // Going the other way, from image files back to the UO data files
+#include "stats.hpp" // Measuring where the time goes (the --stats option)
+#include "texturearchive.hpp" // Our access to the UO texture data files
 
 //=======================================================================================================
 using namespace std::string_literals ;  // We want to be able to use "strings" (not C strings).  This allows us to append a "s" to the string and indicate it is a std::string
@@ -68,106 +72,86 @@ int main(int argc, const char * argv[]) {
     try {
         // This is where we will put our code
         
+        // First, see what the user asked us to do on the command line (this throws if it does not understand something)
+        auto options = Options::parse(argc, argv) ;
+        if (options.help) {
+            std::cout << Options::usage() ;
+            return return_value ;
+        }
+        // Nothing is measured unless asked for (see stats.hpp)
+        if (options.stats != StatsMode::off) {
+            Stats::enable();
+        }
+        auto totalTimer = StageTimer(Stage::total) ;
+        
+        // Packing is the reverse of everything below, it makes a texidx.mul and texmaps.mul from the image files
+        if (!options.pack.empty()) {
+            auto packed = packTextures(options.pack, options) ;
+            totalTimer.stop();
+            if (options.stats == StatsMode::json) {
+                std::cout << Stats::json() ;
+                return return_value ;
+            }
+            std::cout << "Packed " << packed.textures << " textures (" << packed.shared << " sharing the data of another) into " << packed.entries << " entries, texmaps.mul is " << packed.bytes << " bytes" << std::endl;
+            if (options.stats == StatsMode::text) {
+                std::cout << Stats::text() ;
+            }
+            return return_value ;
+        }
+        
         // ************************************************************************************************
         // UO texture data files definitions
         // ************************************************************************************************
-        // The "texidx.mul" file is an index into texmaps.mul file.  it consists of groups three 32 bit integers
-        // The first integer is an offset in bytes into the texmaps.mul file where the data for this entry resides
-        // The second integer is the length in bytes of the data
-        // The third integer is an indicator if it is a 64x64 (value 0) or a 128x128 (value 1) texture
-        //
-        // The texmaps.mul is a file that consists of "pixel data" for the textures. It is streams of 16 bit color values
-        // With the size, and coniguration of the entry provided in the texidx.mul file, one can interpret the data.
-        //
-        // UO 16 bit color value.  UO uses a non alpha 0555 16 bit color scheme. That means the msb (Most signficant bit) is not used.
-        // The remaining groups of bits (grouped in 5 bits) rpresent the color value for Red, Green, Blue. It is worth noting
-        // that UO did not use "true black" (R:0,G:0,B:0). That was for "no color" or transparent (they did this with stencils back in the day).
-        // So the color word looks like this:
-        // 15 14 13 12 11 10 09 08 07 06 05 04 03 02 01 00   Bits
-        //  X  R  R  R  R  R  G  G  G  G  G  B  B  B  B  B
+        // The layout of texidx.mul and texmaps.mul (and the UO 16 bit color value) is documented in texturearchive.hpp
         
         // Lets create the full file path for the two files we are interested in:
         auto idxpath = UOPATH / std::filesystem::path("texidx.mul") ;  // the / operator concatenates file path types, and inserts a directory separator between them
         auto mulpath = UOPATH / std::filesystem::path("texmaps.mul") ;
         
-        // Try to open the files
-        auto idx = std::ifstream(idxpath.string(),std::ios::binary) ; // we use the binary attribute as the data is binary
-        auto mul = std::ifstream(mulpath.string(),std::ios::binary) ;
-        if (!idx.is_open()){
-            // For some reason we could not open the file!
-            throw std::runtime_error("Unable to open the index file: "s + idxpath.string()); // Note the use of the "s" at the end of the first string. We want to do concantation with +, and std::strings can do that.
-        }
-        if (!mul.is_open()){
-            // For some reason we could not open the file!
-            throw std::runtime_error("Unable to open the data file: "s + mulpath.string()); // Note the use of the "s" at the end of the first string. We want to do concantation with +, and std::strings can do that.
+        // Open the two files. The archive memory maps both files (so the operating system brings in the data as we touch it,
+        // instead of us doing a seek and read into a fresh buffer for every texture), and checks every index entry once.
+        // If it can not open either file, it will throw an exception (which we catch below).
+        auto indexTimer = StageTimer(Stage::indexParse) ;
+        auto archive = TextureArchive(idxpath, mulpath) ;
+        indexTimer.stop();
+        // An entry that points outside the data is left out, the same as an unused one, but we say so
+        for (const auto &problem : archive.problems()) {
+            std::cerr << problem << std::endl;
         }
+        Stats::add(Counter::entries, archive.size());
+        Stats::add(Counter::bytesRead, archive.size() * 12);  // Each index entry is 12 bytes
         
-        //
-        auto entrynum = 0 ; // This will be our counter so we know what entry number we are on.
-        auto offset = std::uint32_t(0) ; // This is what we will read into for our offset
-        auto length = std::uint32_t(0) ; // This is what we will read into for our length ;
-        auto flag = std::uint32_t(0) ; // This is what we will read into for our flag (indicator)
-        
-        while (idx.good() && !idx.eof()){  //Loop while the stream is good and not end of file
-            idx.read(reinterpret_cast<char*>(&offset), 4) ; // fstreams need a char* for the buffer that data will be read into. So we take the address of our variable (&)
-            // That would make a std::uint32_t*.  We use reinterpret_cast to make it a char*
-            // The 4 is the number of bytes to read
-            idx.read(reinterpret_cast<char*>(&length),4) ;
-            idx.read(reinterpret_cast<char*>(&flag),4) ;
-            if (idx.gcount()==4) {  // we want to ensure we read 4 bytes with the last read
-                
-                // We did!, now see if the offset and length are valid
-                if (offset != 0xFFFFFFFF && length != 0 && length != 0xFFFFFFFF) { // We check to ensure offset is not "-1" and length not 0 (no bytes), nor -1
-                    // Ok, this entry is pointing to valid data!
-                    // we want to read the data from the file.
-                    // We will do this with a vector, but a unique_ptr would be a valid alternative
-                    auto data = std::vector<std::uint16_t>(length/2,0) ;  // Make a vector of unsigned 16 bit words, the size of "length" in words (why /2), and initialize them to 0
-                    // we will use this data buffer to read into
-                    mul.seekg(offset,std::ios::beg); // Seek to where the data is
-                    mul.read(reinterpret_cast<char*>(data.data()),length);
-                    // Data now has our texture data
-                    auto width = (flag == 1?128:64) ; // If the flag is 1, it is 128x128, otherwise 64x64
-                    // Create our two BMP structures we will use
-                    auto dib = DibHeader(width, width) ; // Since the textures we are dealing with are a square, we can use width for both height and width
-                    auto bmp = BmpHeader() ; // our bmp file header
-                    auto pad = dib.padBytes() ; // Doe we hav any pad bytes we need to add for each line (we dont, but we have this here to show what one should be worried about).
-                    // Now we can calculate our total file size
-                    bmp.bmpFileSize = 14 + 40 + (((width*2)+ pad) * width); // size of the file header + size of dib header + size of pixeldata (including pad if any)
-                    bmp.dataOffset = 54 ; // Since we are not using pallette, we know the pixel data will be the size of the bmp file header, plus the size of the DIB headers
-                    // Now lets create our file
-                    char filestring[11] ; // We will make a character string space to hold the file name
-                    filestring[10] = 0 ; // We will "null" terminate the string (we should set the entire array to 0, but since we "KNOW" we will fill the rest with characters from our sprintnf, we can get aways with this.
-                    std::snprintf(filestring, 11, "0x%04X.bmp",entrynum); // make the file name just be the entry number in hex. Make all entry names be 4 characters, and pad with 0 (what the 04 does). Upper case the hex (why capital X)
-                    auto output = std::ofstream(filestring,std::ios::binary) ;  // Create the bmp file
-                    bmp.save(output); // Write the bmp header to the file
-                    dib.save(output) ; // Write the dib header to the file
-                    // Create a "zero" piece of data to write for any pad values
-                    auto zero = std::uint8_t(0) ;
-                    // Remember the BMP starts with the scan lines inverted, so we have to invert it here
-                    // This will write data line by line, so we can add pad values if we had any
-                    for (auto i = 0 ; i < width;i++){
-                        // We need the offset to the start of the pixel data for each line. The pixel data is 2 bytes, and we need to take a row of it (so width value) at a time
-                        // so to index into the data we do the following:
-                        // the width of the line minus the line we are on (remember, we are going backwords) and the subtract one from that (we are zero index).
-                        // So say we are we 128 x 128 (remember, width/height are the same).
-                        // The fist time through the loop, the index (i) is zero.  But since we want to reverse the order (we want to start with line 127(0-127),
-                        // we subtractd the index from with width (128 - 0), so that would put us at 128. Since we are zero indexed, we subtract 1, and get 127
-                        // which is what we want, the last row. The second time through index is 1, so we get (128-1) -1 which is 126, and so on.  The last value
-                        // is 127 (so  (128-127)-1 which is 0, so the first row (but we write it last, again reversed).
-                        auto offset = ((width -i)-1) * (width*2) ; // THis is calculating the offset to put the bottom row first in the bmp file (scan lines are reversed)
-                        output.write(reinterpret_cast<const char*>(data.data())+ offset, width*2) ;
-                        // Now write any pad bytes we need  (in this case, we wont have any, since 64x64 or 128x128 16 bit values, will always be a multiple of
-                        // of 32 bytes per line, so we dont need any padding bytes to meet the specification. But we have it for demonstrations purposes.
-                        for (auto z=0 ; z < pad;z++) {
-                            output.write(reinterpret_cast<char*>(&zero),1) ;
-                        }
-                    }
-                    
-                }
-                entrynum++ ; // Increment the entry counter to the next texture id
-            }
+        // Now convert every valid entry into an image file. How that is done (on one thread, or spread out on several),
+        // is in exporter.cpp, and how the image files are made is in imageencoder.cpp
+        auto summary = exportTextures(archive, options) ;
+        totalTimer.stop();
+        // Every file that could not be written is listed, and the run counts as failed (but all the rest were written)
+        for (const auto &failure : summary.failures) {
+            std::cerr << "Unable to write " << failure << std::endl;
+        }
+        if (!summary.failures.empty()) {
+            return_value = EXIT_FAILURE ;
+        }
+        if (options.stats == StatsMode::json) {
+            // Only the report, so a program reading it does not have to pick it out from the lines below
+            std::cout << Stats::json() ;
+            return return_value ;
+        }
+        auto entrynum = summary.entries ; // The number of entries we processed
+        if (summary.incremental) {
+            std::cout << "Incremental export: " << summary.added << " added, " << summary.changed << " changed, " << summary.removed << " removed, " << summary.unchanged << " unchanged" << std::endl;
+        }
+        if (options.dedup != DedupMode::off) {
+            std::cout << "Deduplicated " << summary.duplicates << " entries, saving " << summary.bytesSaved << " bytes and " << summary.writesSaved << " writes" << std::endl;
+        }
+        // How much of each kind of file we wrote (so the formats and compression levels can be compared)
+        for (const auto &[format, total] : summary.formats) {
+            std::cout << "Wrote " << total.files << " " << format << " files, " << total.bytes << " bytes" << std::endl;
         }
         std::cout <<"Processed " << entrynum << " entries" << std::endl;
+        if (options.stats == StatsMode::text) {
+            std::cout << Stats::text() ;
+        }
     }
     // If any of our routines throw an exception that is based of std::exception
     catch(const std::exception &e){
@@ -0,0 +1,167 @@
+//
+
+#include "manifest.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "mappedfile.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    constexpr auto magic = std::uint32_t(0x464D5854) ;  // 'TXMF'
+    constexpr auto version = std::uint32_t(1) ;
+    constexpr auto headerSize = std::size_t(20) ;
+    constexpr auto recordSize = std::size_t(24) ;
+    //==========================================================================================================================
+    auto put(std::vector<std::uint8_t> &buffer, std::uint64_t value, int size) -> void {
+        for (auto i = 0 ; i < size ; i++) {
+            buffer.push_back(static_cast<std::uint8_t>((value >> (8*i)) & 0xFF));
+        }
+    }
+    //==========================================================================================================================
+    auto get(const std::uint8_t *data, int size) -> std::uint64_t {
+        auto value = std::uint64_t(0) ;
+        for (auto i = 0 ; i < size ; i++) {
+            value |= static_cast<std::uint64_t>(data[i]) << (8*i) ;
+        }
+        return value ;
+    }
+}
+
+//==============================================================================================================================
+// ManifestEntry
+//==============================================================================================================================
+//==============================================================================================================================
+auto ManifestEntry::valid() const -> bool {
+    return canonical >= 0 ;
+}
+//==============================================================================================================================
+// The offset and length can change (say, a patch moved the data) without the pixels changing, so we only compare
+// what the output depends on: the size, the pixels, and what it is a duplicate of
+auto ManifestEntry::sameOutput(const ManifestEntry &other) const -> bool {
+    return flag == other.flag && hash == other.hash && canonical == other.canonical ;
+}
+
+//==============================================================================================================================
+// ManifestDiff
+//==============================================================================================================================
+//==============================================================================================================================
+auto ManifestDiff::empty() const -> bool {
+    return added.empty() && changed.empty() && removed.empty() ;
+}
+
+//==============================================================================================================================
+// Manifest
+//==============================================================================================================================
+//==============================================================================================================================
+Manifest::Manifest():settings(0) {
+}
+//==============================================================================================================================
+Manifest::Manifest(const TextureArchive &archive, const ContentIndex &content, std::uint64_t settings):settings(settings) {
+    entries.reserve(archive.size()) ;
+    for (auto id = 0 ; id < static_cast<int>(archive.size()) ; id++) {
+        const auto &entry = archive.entry(id) ;
+        auto index = static_cast<std::size_t>(id) ;
+        entries.push_back(ManifestEntry{entry.offset, entry.length, entry.flag, content.canonical[index], content.hashes[index]});
+    }
+}
+//==============================================================================================================================
+auto Manifest::load(const std::filesystem::path &path) -> bool {
+    entries.clear();
+    settings = 0 ;
+    if (!std::filesystem::exists(path)) {
+        return false ;
+    }
+    auto file = MappedFile(path, false) ;
+    auto data = file.data() ;
+    if (file.size() < headerSize || get(data, 4) != magic || get(data + 4, 4) != version) {
+        return false ;
+    }
+    auto count = static_cast<std::size_t>(get(data + 16, 4)) ;
+    if (file.size() != headerSize + count * recordSize) {
+        return false ;  // Truncated, or something else entirely
+    }
+    settings = get(data + 8, 8) ;
+    entries.reserve(count) ;
+    for (auto index = std::size_t(0) ; index < count ; index++) {
+        auto record = data + headerSize + index * recordSize ;
+        entries.push_back(ManifestEntry{
+            static_cast<std::uint32_t>(get(record, 4)),
+            static_cast<std::uint32_t>(get(record + 4, 4)),
+            static_cast<std::uint32_t>(get(record + 8, 4)),
+            static_cast<std::int32_t>(static_cast<std::uint32_t>(get(record + 12, 4))),
+            get(record + 16, 8)
+        });
+    }
+    return true ;
+}
+//==============================================================================================================================
+// We write to a temporary file and then rename it, so an interrupted run never leaves a half written manifest behind
+auto Manifest::save(const std::filesystem::path &path) const -> void {
+    auto data = std::vector<std::uint8_t>() ;
+    data.reserve(headerSize + entries.size() * recordSize) ;
+    put(data, magic, 4) ;
+    put(data, version, 4) ;
+    put(data, settings, 8) ;
+    put(data, entries.size(), 4) ;
+    for (const auto &entry : entries) {
+        put(data, entry.offset, 4) ;
+        put(data, entry.length, 4) ;
+        put(data, entry.flag, 4) ;
+        put(data, static_cast<std::uint32_t>(entry.canonical), 4) ;
+        put(data, entry.hash, 8) ;
+    }
+    auto temporary = path ;
+    temporary += ".tmp" ;
+    {
+        auto output = std::ofstream(temporary.string(),std::ios::binary) ;
+        output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())) ;
+        if (!output) {
+            throw std::runtime_error("Unable to write the manifest: "s + temporary.string());
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+//==============================================================================================================================
+auto Manifest::settingsHash() const -> std::uint64_t {
+    return settings ;
+}
+//==============================================================================================================================
+auto Manifest::size() const -> std::size_t {
+    return entries.size() ;
+}
+//==============================================================================================================================
+auto Manifest::entry(int id) const -> const ManifestEntry& {
+    return entries.at(static_cast<std::size_t>(id)) ;
+}
+//==============================================================================================================================
+auto Manifest::diff(const Manifest &previous) const -> ManifestDiff {
+    auto result = ManifestDiff{{}, {}, {}, 0} ;
+    auto invalid = ManifestEntry{0xFFFFFFFF, 0, 0, -1, 0} ;
+    auto count = std::max(entries.size(), previous.entries.size()) ;
+    for (auto index = std::size_t(0) ; index < count ; index++) {
+        const auto &now = (index < entries.size() ? entries[index] : invalid) ;
+        const auto &before = (index < previous.entries.size() ? previous.entries[index] : invalid) ;
+        auto id = static_cast<int>(index) ;
+        if (now.valid() && !before.valid()) {
+            result.added.push_back(id);
+        }
+        else if (!now.valid() && before.valid()) {
+            result.removed.push_back(id);
+        }
+        else if (now.valid()) {
+            if (!now.sameOutput(before)) {
+                result.changed.push_back(id);
+            }
+            else {
+                result.unchanged++ ;
+            }
+        }
+    }
+    return result ;
+}
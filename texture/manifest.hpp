@@ -0,0 +1,80 @@
+//
+
+#ifndef manifest_hpp
+#define manifest_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "dedup.hpp"
+#include "texturearchive.hpp"
+
+//======================================================================
+/* Manifest
+ A record, written after each export, of what every index entry looked like when it was exported, along with a
+ hash of the settings that change what the output looks like (depth, atlas, ...).
+ An incremental export compares the current texidx.mul/texmaps.mul against it, and only re-encodes the entries
+ that were added or changed, and removes the output of the entries that are no longer valid.  An entry has changed
+ if its size (flag), pixels (hash), or the entry it is a duplicate of is different; data that only moved in the
+ file (a different offset) does not need encoding again.
+
+ texture.manifest (all values little endian)
+ Offset      Size        Purpose
+ 0           4 bytes     'TXMF'
+ 4           4 bytes     Version (1)
+ 8           8 bytes     Hash of the output settings
+ 16          4 bytes     Number of entries
+ 20          24 bytes    For each entry (in id order):
+                              4 bytes     Offset (from texidx.mul)
+                              4 bytes     Length (from texidx.mul)
+                              4 bytes     Flag (from texidx.mul)
+                              4 bytes     The id it is a duplicate of, its own id if it is not, 0xFFFFFFFF if invalid
+                              8 bytes     Hash of the pixels (see hash.hpp), 0 if invalid
+ */
+
+//==============================================================================================================================
+// ManifestEntry
+//==============================================================================================================================
+struct ManifestEntry {
+    std::uint32_t offset ;
+    std::uint32_t length ;
+    std::uint32_t flag ;
+    std::int32_t canonical ;
+    std::uint64_t hash ;
+    auto valid() const -> bool ;
+    auto sameOutput(const ManifestEntry &other) const -> bool ;
+};
+
+//==============================================================================================================================
+// ManifestDiff
+//==============================================================================================================================
+// What changed between two manifests
+struct ManifestDiff {
+    std::vector<int> added ;  // Valid now, and were not before
+    std::vector<int> changed ;  // Valid both times, but the output would be different
+    std::vector<int> removed ;  // Were valid, and are not now
+    std::size_t unchanged ;  // Valid both times, and the same
+    auto empty() const -> bool ;
+};
+
+//==============================================================================================================================
+// Manifest
+//==============================================================================================================================
+class Manifest {
+    std::uint64_t settings ;
+    std::vector<ManifestEntry> entries ;
+public:
+    static constexpr auto filename = "texture.manifest" ;
+    Manifest() ;
+    Manifest(const TextureArchive &archive, const ContentIndex &content, std::uint64_t settings) ;
+    auto load(const std::filesystem::path &path) -> bool ;  // False if there is none, or it is not a manifest we understand
+    auto save(const std::filesystem::path &path) const -> void ;
+    auto settingsHash() const -> std::uint64_t ;
+    auto size() const -> std::size_t ;
+    auto entry(int id) const -> const ManifestEntry& ;
+    auto diff(const Manifest &previous) const -> ManifestDiff ;  // What changed, going from previous to this
+};
+
+#endif /* manifest_hpp */
@@ -0,0 +1,196 @@
+//
+
+#include "mappedfile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TEXTURE_HAVE_MMAP 1
+#endif
+
+using namespace std::string_literals ;
+
+//======================================================================
+
+//==============================================================================================================================
+// MappedFile
+//==============================================================================================================================
+//==============================================================================================================================
+MappedFile::MappedFile():ptr(nullptr),length(0),isMapped(false) {
+#if defined(_WIN32)
+    fileHandle = INVALID_HANDLE_VALUE ;
+    mapHandle = nullptr ;
+#endif
+}
+//==============================================================================================================================
+MappedFile::MappedFile(const std::filesystem::path &path, bool allowMapping):MappedFile() {
+    open(path,allowMapping);
+}
+//==============================================================================================================================
+MappedFile::~MappedFile() {
+    close();
+}
+//==============================================================================================================================
+MappedFile::MappedFile(MappedFile &&other) noexcept :MappedFile() {
+    *this = std::move(other) ;
+}
+//==============================================================================================================================
+auto MappedFile::operator=(MappedFile &&other) noexcept -> MappedFile& {
+    if (this != &other) {
+        close();
+        ptr = std::exchange(other.ptr, nullptr) ;
+        length = std::exchange(other.length, 0) ;
+        isMapped = std::exchange(other.isMapped, false) ;
+        buffer = std::move(other.buffer) ;
+#if defined(_WIN32)
+        fileHandle = std::exchange(other.fileHandle, INVALID_HANDLE_VALUE) ;
+        mapHandle = std::exchange(other.mapHandle, nullptr) ;
+#endif
+    }
+    return *this ;
+}
+//==============================================================================================================================
+auto MappedFile::open(const std::filesystem::path &path, bool allowMapping) -> void {
+    close();
+    if (!allowMapping || !map(path)) {
+        stream(path);
+    }
+}
+//==============================================================================================================================
+auto MappedFile::close() -> void {
+    if (isMapped) {
+        unmap();
+    }
+    buffer.reset();
+    ptr = nullptr ;
+    length = 0 ;
+    isMapped = false ;
+}
+//==============================================================================================================================
+auto MappedFile::data() const -> const std::uint8_t* {
+    return ptr ;
+}
+//==============================================================================================================================
+auto MappedFile::size() const -> std::size_t {
+    return length ;
+}
+//==============================================================================================================================
+auto MappedFile::mapped() const -> bool {
+    return isMapped ;
+}
+
+//==============================================================================================================================
+// Platform specific mapping.  If we return false, the caller falls back to streaming the file into memory
+//==============================================================================================================================
+#if defined(_WIN32)
+//==============================================================================================================================
+auto MappedFile::map(const std::filesystem::path &path) -> bool {
+    fileHandle = ::CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false ;
+    }
+    auto filesize = LARGE_INTEGER() ;
+    if (!::GetFileSizeEx(fileHandle, &filesize) || filesize.QuadPart == 0) {
+        // We can not map an empty file, let the streaming path deal with it
+        ::CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE ;
+        return false ;
+    }
+    mapHandle = ::CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapHandle == nullptr) {
+        ::CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE ;
+        return false ;
+    }
+    auto view = ::MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        ::CloseHandle(mapHandle);
+        ::CloseHandle(fileHandle);
+        mapHandle = nullptr ;
+        fileHandle = INVALID_HANDLE_VALUE ;
+        return false ;
+    }
+    ptr = static_cast<const std::uint8_t*>(view) ;
+    length = static_cast<std::size_t>(filesize.QuadPart) ;
+    isMapped = true ;
+    return true ;
+}
+//==============================================================================================================================
+auto MappedFile::unmap() -> void {
+    ::UnmapViewOfFile(ptr);
+    ::CloseHandle(mapHandle);
+    ::CloseHandle(fileHandle);
+    mapHandle = nullptr ;
+    fileHandle = INVALID_HANDLE_VALUE ;
+}
+#elif defined(TEXTURE_HAVE_MMAP)
+//==============================================================================================================================
+auto MappedFile::map(const std::filesystem::path &path) -> bool {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false ;
+    }
+    struct stat info ;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        // We can not map an empty file, let the streaming path deal with it
+        ::close(fd);
+        return false ;
+    }
+    auto view = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps its own reference to the file
+    if (view == MAP_FAILED) {
+        return false ;
+    }
+    ptr = static_cast<const std::uint8_t*>(view) ;
+    length = static_cast<std::size_t>(info.st_size) ;
+    isMapped = true ;
+    return true ;
+}
+//==============================================================================================================================
+auto MappedFile::unmap() -> void {
+    ::munmap(const_cast<std::uint8_t*>(ptr), length);
+}
+#else
+//==============================================================================================================================
+auto MappedFile::map(const std::filesystem::path &) -> bool {
+    return false ;
+}
+//==============================================================================================================================
+auto MappedFile::unmap() -> void {
+}
+#endif
+
+//==============================================================================================================================
+// We read the file into one buffer, in large chunks.  We use a unique_ptr rather than a vector, since a vector
+// would zero fill the memory before we overwrite it with the file contents.
+auto MappedFile::stream(const std::filesystem::path &path) -> void {
+    auto input = std::ifstream(path.string(),std::ios::binary) ;
+    if (!input.is_open()) {
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    auto filesize = static_cast<std::size_t>(std::filesystem::file_size(path)) ;
+    buffer = std::unique_ptr<std::uint8_t[]>(new std::uint8_t[std::max<std::size_t>(filesize,1)]) ;
+    constexpr auto chunk = std::size_t(1024*1024) ;
+    auto total = std::size_t(0) ;
+    while (total < filesize) {
+        auto amount = std::min(chunk, filesize - total) ;
+        input.read(reinterpret_cast<char*>(buffer.get()) + total, static_cast<std::streamsize>(amount));
+        if (input.gcount() != static_cast<std::streamsize>(amount)) {
+            throw std::runtime_error("Unable to read: "s + path.string());
+        }
+        total += amount ;
+    }
+    ptr = buffer.get() ;
+    length = filesize ;
+    isMapped = false ;
+}
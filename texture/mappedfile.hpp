@@ -0,0 +1,49 @@
+//
+
+#ifndef mappedfile_hpp
+#define mappedfile_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+//==============================================================================================================================
+// MappedFile
+//==============================================================================================================================
+/*
+ A read only view of an entire file.
+ When the platform supports it (mmap on unix, CreateFileMapping on windows) the file is memory mapped, so
+ the operating system pages the data in as we touch it, and nothing is copied.  If mapping is not
+ available (or fails, or the caller asks us not to), the file is streamed into a single buffer we own.
+ Either way, the caller just gets a pointer and a size that are valid until the MappedFile is closed or destroyed.
+ */
+class MappedFile {
+    const std::uint8_t *ptr ;
+    std::size_t length ;
+    bool isMapped ;
+    std::unique_ptr<std::uint8_t[]> buffer ;  // Only used when we are not mapped
+#if defined(_WIN32)
+    void *fileHandle ;
+    void *mapHandle ;
+#endif
+    auto map(const std::filesystem::path &path) -> bool ;
+    auto unmap() -> void ;
+    auto stream(const std::filesystem::path &path) -> void ;
+public:
+    MappedFile() ;
+    MappedFile(const std::filesystem::path &path, bool allowMapping = true) ;
+    ~MappedFile() ;
+    MappedFile(const MappedFile &) = delete ;
+    auto operator=(const MappedFile &) -> MappedFile& = delete ;
+    MappedFile(MappedFile &&other) noexcept ;
+    auto operator=(MappedFile &&other) noexcept -> MappedFile& ;
+
+    auto open(const std::filesystem::path &path, bool allowMapping = true) -> void ;
+    auto close() -> void ;
+    auto data() const -> const std::uint8_t* ;
+    auto size() const -> std::size_t ;
+    auto mapped() const -> bool ;
+};
+
+#endif /* mappedfile_hpp */
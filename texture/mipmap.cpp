@@ -0,0 +1,56 @@
+//
+
+#include "mipmap.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include "colorconvert.hpp"
+
+using namespace std::string_literals ;
+
+//==============================================================================================================================
+// MipChain
+//==============================================================================================================================
+//==============================================================================================================================
+MipChain::MipChain(const std::uint16_t *texture, int width):baseWidth(width) {
+    if (width <= 0 || (width & (width - 1)) != 0) {
+        throw std::runtime_error("Mip levels need a width that is a power of 2, not "s + std::to_string(width));
+    }
+    auto total = std::size_t(0) ;
+    for (auto size = width / 2 ; size > 0 ; size /= 2) {
+        offsets.push_back(total);
+        total += static_cast<std::size_t>(size) * static_cast<std::size_t>(size) ;
+    }
+    pixels.resize(total) ;
+    auto source = texture ;
+    for (auto number = 1 ; number <= levels() ; number++) {
+        auto size = width >> (number - 1) ;
+        auto output = pixels.data() + offsets[static_cast<std::size_t>(number - 1)] ;
+        halveImage(source, size, size, output) ;
+        source = output ;
+    }
+}
+//==============================================================================================================================
+auto MipChain::levels() const -> int {
+    return static_cast<int>(offsets.size()) ;
+}
+//==============================================================================================================================
+auto MipChain::width(int level) const -> int {
+    return baseWidth >> level ;
+}
+//==============================================================================================================================
+auto MipChain::level(int level) const -> const std::uint16_t* {
+    if (level < 1 || level > levels()) {
+        throw std::out_of_range("Mip level "s + std::to_string(level) + " does not exist"s);
+    }
+    return pixels.data() + offsets[static_cast<std::size_t>(level - 1)] ;
+}
+//==============================================================================================================================
+auto MipChain::levelCount(int width) -> int {
+    auto count = 0 ;
+    for (auto size = width / 2 ; size > 0 ; size /= 2) {
+        count++ ;
+    }
+    return count ;
+}
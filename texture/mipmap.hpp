@@ -0,0 +1,33 @@
+//
+
+#ifndef mipmap_hpp
+#define mipmap_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//==============================================================================================================================
+// MipChain
+//==============================================================================================================================
+/*
+ The smaller versions (mip levels) of a texture, that a renderer uses when the texture is drawn smaller than it is.
+ Level 0 is the texture itself, each level after that is half the width and height of the one before (each pixel the
+ average of a 2x2 block, see halveImage in colorconvert.hpp), down to 1x1.  So a 128x128 texture has levels 1-7
+ (64 down to 1), and a 64x64 one levels 1-6.
+ Every level is made in one pass, each from the one before, right after the texture is read (while its pixels are
+ still in the processor's cache), and they are all kept in one buffer.
+ */
+class MipChain {
+    int baseWidth ;
+    std::vector<std::uint16_t> pixels ;  // Levels 1 and up, one after the other
+    std::vector<std::size_t> offsets ;  // Where each level starts in pixels (offsets[0] is level 1)
+public:
+    MipChain(const std::uint16_t *texture, int width) ;  // The width must be a power of 2
+    auto levels() const -> int ;  // The number of levels after level 0
+    auto width(int level) const -> int ;
+    auto level(int level) const -> const std::uint16_t* ;  // Level 1 and up, width(level) * width(level) pixels, top row first
+    static auto levelCount(int width) -> int ;  // The number of levels after level 0 a texture of this width has
+};
+
+#endif /* mipmap_hpp */
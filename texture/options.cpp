@@ -0,0 +1,204 @@
+//
+
+#include "options.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include "workpool.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    // Convert text to a non negative integer, or throw saying which option it was for
+    auto toNumber(const std::string &option, const std::string &value) -> int {
+        auto used = std::size_t(0) ;
+        auto number = 0 ;
+        try {
+            number = std::stoi(value, &used) ;
+        }
+        catch(...) {
+            used = 0 ;
+        }
+        if (used == 0 || used != value.size() || number < 0) {
+            throw std::runtime_error("Invalid value for "s + option + ": "s + value);
+        }
+        return number ;
+    }
+}
+
+//==============================================================================================================================
+// Options
+//==============================================================================================================================
+//==============================================================================================================================
+Options::Options():jobs(1),depth(16),format(ImageFormat::bmp),level(6),atlas(false),atlasSize(2048),dedup(DedupMode::off),mips(false),incremental(false),writer(WriteBackend::automatic),queueDepth(32),stats(StatsMode::off),help(false) {
+}
+//==============================================================================================================================
+auto Options::parse(int argc, const char *argv[]) -> Options {
+    auto options = Options() ;
+    auto arguments = std::vector<std::string>(argv + 1, argv + argc) ;
+    for (auto i = std::size_t(0) ; i < arguments.size() ; i++) {
+        auto argument = arguments[i] ;
+        auto value = std::string() ;
+        auto hasValue = false ;
+        // Allow both "--option value" and "--option=value"
+        auto equal = argument.find('=') ;
+        if (argument.size() > 2 && argument[0] == '-' && argument[1] == '-' && equal != std::string::npos) {
+            value = argument.substr(equal + 1) ;
+            argument = argument.substr(0, equal) ;
+            hasValue = true ;
+        }
+        // Get the value for an option that requires one
+        auto next = [&]() -> std::string {
+            if (hasValue) {
+                return value ;
+            }
+            if (i + 1 >= arguments.size()) {
+                throw std::runtime_error("Missing value for "s + argument);
+            }
+            return arguments[++i] ;
+        };
+        if (argument == "--help" || argument == "-h") {
+            options.help = true ;
+        }
+        else if (argument == "--jobs" || argument == "-j") {
+            options.jobs = toNumber(argument, next()) ;
+            if (options.jobs == 0) {
+                options.jobs = WorkPool::hardwareWorkers() ;
+            }
+        }
+        else if (argument == "--depth") {
+            options.depth = toNumber(argument, next()) ;
+            if (options.depth != 16 && options.depth != 24 && options.depth != 32) {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + std::to_string(options.depth) + " (must be 16, 24, or 32)"s);
+            }
+        }
+        else if (argument == "--format") {
+            auto format = next() ;
+            if (format == "bmp") {
+                options.format = ImageFormat::bmp ;
+            }
+            else if (format == "qoi") {
+                options.format = ImageFormat::qoi ;
+            }
+            else if (format == "png") {
+                options.format = ImageFormat::png ;
+            }
+            else {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + format + " (must be bmp, qoi, or png)"s);
+            }
+        }
+        else if (argument == "--level") {
+            options.level = toNumber(argument, next()) ;
+            if (options.level > 9) {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + std::to_string(options.level) + " (must be 0 to 9)"s);
+            }
+        }
+        else if (argument == "--atlas") {
+            options.atlas = true ;
+        }
+        else if (argument == "--atlas-size") {
+            options.atlasSize = toNumber(argument, next()) ;
+            if (options.atlasSize == 0 || options.atlasSize % 128 != 0 || options.atlasSize > 32768) {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + std::to_string(options.atlasSize) + " (must be a multiple of 128, up to 32768)"s);
+            }
+        }
+        else if (argument == "--dedup") {
+            auto mode = next() ;
+            if (mode == "link") {
+                options.dedup = DedupMode::link ;
+            }
+            else if (mode == "alias") {
+                options.dedup = DedupMode::alias ;
+            }
+            else {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + mode + " (must be link or alias)"s);
+            }
+        }
+        else if (argument == "--mips") {
+            options.mips = true ;
+        }
+        else if (argument == "--incremental") {
+            options.incremental = true ;
+        }
+        else if (argument == "--writer") {
+            auto backend = next() ;
+            if (backend == "auto") {
+                options.writer = WriteBackend::automatic ;
+            }
+            else if (backend == "uring") {
+                options.writer = WriteBackend::uring ;
+            }
+            else if (backend == "pwrite") {
+                options.writer = WriteBackend::pwrite ;
+            }
+            else if (backend == "stream") {
+                options.writer = WriteBackend::stream ;
+            }
+            else {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + backend + " (must be auto, uring, pwrite, or stream)"s);
+            }
+        }
+        else if (argument == "--queue-depth") {
+            options.queueDepth = toNumber(argument, next()) ;
+            if (options.queueDepth == 0 || options.queueDepth > 4096) {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + std::to_string(options.queueDepth) + " (must be 1 to 4096)"s);
+            }
+        }
+        else if (argument == "--pack") {
+            options.pack = next() ;
+            if (options.pack.empty()) {
+                throw std::runtime_error("Missing value for "s + argument);
+            }
+        }
+        else if (argument == "--stats") {
+            // The format is optional, so it can only be given as --stats=FORMAT
+            auto format = (hasValue ? value : "text"s) ;
+            if (format == "text") {
+                options.stats = StatsMode::text ;
+            }
+            else if (format == "json") {
+                options.stats = StatsMode::json ;
+            }
+            else {
+                throw std::runtime_error("Invalid value for "s + argument + ": "s + format + " (must be text or json)"s);
+            }
+        }
+        else {
+            throw std::runtime_error("Unknown option: "s + arguments[i] + "\n"s + usage());
+        }
+    }
+    return options ;
+}
+//==============================================================================================================================
+auto Options::usage() -> std::string {
+    return "Usage: texture [options]\n"s +
+    "  --jobs N, -j N      Worker threads to decode/encode with (default 1, 0 = one per hardware thread)\n"s +
+    "  --depth N           Bits per pixel of the bmp files: 16 (default), 24, or 32 (with alpha)\n"s +
+    "  --format FORMAT     Image files to write: bmp (default), qoi, or png\n"s +
+    "  --level N           png compression level, 0 (none) to 9 (smallest), default 6\n"s +
+    "  --atlas             Pack the textures into atlas pages (atlas_nn.bmp, atlas.json, atlas.bin)\n"s +
+    "  --atlas-size N      Largest atlas page width/height in pixels (default 2048, a multiple of 128)\n"s +
+    "  --dedup MODE        Write identical textures once; later ids become hard links (link) or aliases.json entries (alias)\n"s +
+    "  --mips              Also write each texture's mip levels (0x%04X_1 at half size, ... down to 1x1)\n"s +
+    "  --incremental       Only encode what was added or changed since the last export (uses texture.manifest)\n"s +
+    "  --writer BACKEND    How files are written: auto (default), uring, pwrite, or stream\n"s +
+    "  --queue-depth N     File operations the writer keeps in flight (default 32)\n"s +
+    "  --stats[=FORMAT]    Report where the time went, as a table (text, default) or json\n"s +
+    "  --pack DIR          Build texidx.mul/texmaps.mul here from the 0x%04X.bmp files in DIR\n"s +
+    "  --help, -h          Show this usage\n"s ;
+}
+//==============================================================================================================================
+auto Options::outputSettings() const -> std::string {
+    auto settings = "depth="s + std::to_string(depth) ;
+    settings += ";format="s + imageFormatName(format) ;
+    if (format == ImageFormat::png) {
+        settings += ";level="s + std::to_string(level) ;  // Only png output depends on it
+    }
+    settings += ";atlas="s + (atlas ? std::to_string(atlasSize) : "off"s) ;
+    settings += ";mips="s + (mips ? "on"s : "off"s) ;
+    settings += ";dedup="s + (dedup == DedupMode::link ? "link"s : (dedup == DedupMode::alias ? "alias"s : "off"s)) ;
+    return settings ;
+}
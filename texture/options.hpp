@@ -0,0 +1,74 @@
+//
+
+#ifndef options_hpp
+#define options_hpp
+
+#include <string>
+
+#include "filesink.hpp"
+#include "imageencoder.hpp"
+
+//==============================================================================================================================
+// Options
+//==============================================================================================================================
+/*
+ The settings the user can give on the command line.
+ Anything not recognized causes parse to throw a std::runtime_error, with a message saying what was wrong.
+
+   --jobs N, -j N      Number of worker threads used to decode and encode the textures.  1 (the default) does
+                       everything on the main thread, 0 uses one worker per hardware thread.
+   --depth N           Bits per pixel of the bmp files: 16 (the default, the texture data as is), 24, or 32 (with
+                       alpha, "no color" is transparent)
+   --format FORMAT     The image files written: bmp (the default), qoi, or png (see imageencoder.hpp)
+   --level N           The png compression level, 0 (none, fastest) to 9 (smallest), default 6
+   --atlas             Pack the textures into a few large atlas pages, with a table of where each one is, rather than
+                       writing a file for each (see atlas.hpp)
+   --atlas-size N      The largest width/height of an atlas page in pixels (default 2048).  Must be a multiple of 128
+   --dedup MODE        Only write textures with the same pixels once.  The later ids are either hard links to the
+                       first one's file (link), or listed in aliases.json (alias).  In atlas mode, they share a place.
+   --mips              Also write the mip levels of each texture (each half the size of the one before, down to 1x1,
+                       see mipmap.hpp), as 0x%04X_n files, or on the atlas pages
+   --incremental       Only encode the entries that were added or changed since the last export (see manifest.hpp)
+   --writer BACKEND    How the files are written: auto (the default), uring, pwrite, or stream (see filesink.hpp)
+   --queue-depth N     How many file operations the writer keeps in flight at once (default 32, 1 to 4096)
+   --stats[=FORMAT]    Measure where the time goes, and report it at the end (see stats.hpp), as a table (text, the
+                       default) or as JSON (json, which is then all that is written to stdout)
+   --pack DIR          Rather than exporting, build texidx.mul and texmaps.mul (in the current directory) from the
+                       0x%04X.bmp files in DIR (see packer.hpp).  Uses --jobs workers.
+   --help, -h          Show the usage
+ */
+enum class DedupMode {
+    off,
+    link,
+    alias
+};
+
+enum class StatsMode {
+    off,
+    text,
+    json
+};
+
+struct Options {
+    int jobs ;
+    int depth ;
+    ImageFormat format ;
+    int level ;
+    bool atlas ;
+    int atlasSize ;
+    DedupMode dedup ;
+    bool mips ;
+    bool incremental ;
+    WriteBackend writer ;
+    int queueDepth ;
+    StatsMode stats ;
+    std::string pack ;  // The directory to pack, empty to export
+    bool help ;
+    Options() ;
+    static auto parse(int argc, const char *argv[]) -> Options ;
+    static auto usage() -> std::string ;
+    // A description of every setting that changes what the output looks like (if this changes, everything has to be redone)
+    auto outputSettings() const -> std::string ;
+};
+
+#endif /* options_hpp */
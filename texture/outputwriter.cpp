@@ -0,0 +1,81 @@
+//
+
+#include "outputwriter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "bmproutine.hpp"
+#include "filesink.hpp"
+#include "stats.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+
+//==============================================================================================================================
+// OutputFile
+//==============================================================================================================================
+//==============================================================================================================================
+auto OutputFile::save() const -> void {
+    auto timer = StageTimer(Stage::write) ;
+    saveFile(name, data);
+    Stats::add(Counter::filesWritten);
+    Stats::add(Counter::bytesWritten, data.size());
+}
+
+//==============================================================================================================================
+// OutputWriter
+//==============================================================================================================================
+//==============================================================================================================================
+OutputWriter::OutputWriter(std::size_t capacity, std::unique_ptr<FileSink> sink, std::function<void(const OutputFile &file, const std::string &error)> completed):queue(std::max(capacity, sink->depth())),sink(std::move(sink)),completed(std::move(completed)),finished(false) {
+    writer = std::thread([this]{
+        auto file = OutputFile() ;
+        auto batch = std::vector<OutputFile>() ;
+        try {
+            // Wait for a file, then take any others that are already waiting along with it
+            while (queue.pop(file)) {
+                batch.push_back(std::move(file));
+                while (batch.size() < this->sink->depth() && queue.tryPop(file)) {
+                    batch.push_back(std::move(file));
+                }
+                auto errors = this->sink->write(batch) ;
+                for (auto i = std::size_t(0) ; i < batch.size() ; i++) {
+                    this->completed(batch[i], errors[i]);
+                }
+                batch.clear();
+            }
+        }
+        catch(...) {
+            failure = std::current_exception() ;
+            queue.close();  // So anyone waiting to submit is released
+        }
+    });
+}
+//==============================================================================================================================
+OutputWriter::~OutputWriter() {
+    try {
+        finish();
+    }
+    catch(...) {
+        // A destructor can not throw, if the caller cared about the error they should have called finish
+    }
+}
+//==============================================================================================================================
+auto OutputWriter::submit(OutputFile &&file) -> void {
+    if (!queue.push(std::move(file))) {
+        throw std::runtime_error("Unable to write output, the writer has stopped"s);
+    }
+}
+//==============================================================================================================================
+auto OutputWriter::finish() -> void {
+    if (!finished) {
+        finished = true ;
+        queue.close();
+        writer.join();
+    }
+    if (failure) {
+        std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+}
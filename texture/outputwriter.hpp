@@ -0,0 +1,56 @@
+//
+
+#ifndef outputwriter_hpp
+#define outputwriter_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boundedqueue.hpp"
+#include "filedata.hpp"
+
+//==============================================================================================================================
+// OutputFile
+//==============================================================================================================================
+// A complete, encoded, file that is ready to be written
+struct OutputFile {
+    std::string name ;
+    FileData data ;
+    auto save() const -> void ;  // Write it out (on the calling thread)
+};
+
+//==============================================================================================================================
+// OutputWriter
+//==============================================================================================================================
+/*
+ The last stage of the export pipeline.  Finished files are handed to the writer, which saves them on its own thread.
+ The files are held in a BoundedQueue, so if the disk can not keep up with the workers, the workers wait, rather
+ than the finished files piling up in memory.
+ The writer takes whatever files are waiting (up to the sink's depth) and gives them to its FileSink as one batch
+ (see filesink.hpp).  A file that could not be written does not stop the others.  Once the sink is done with a file,
+ it is passed to the completed function (on the writer's thread), with an empty string if it was written, or why not.
+ */
+class FileSink ;
+class OutputWriter {
+    BoundedQueue<OutputFile> queue ;
+    std::unique_ptr<FileSink> sink ;
+    std::thread writer ;
+    std::function<void(const OutputFile &file, const std::string &error)> completed ;
+    std::exception_ptr failure ;
+    bool finished ;
+public:
+    OutputWriter(std::size_t capacity, std::unique_ptr<FileSink> sink, std::function<void(const OutputFile &file, const std::string &error)> completed) ;
+    ~OutputWriter() ;
+    OutputWriter(const OutputWriter &) = delete ;
+    auto operator=(const OutputWriter &) -> OutputWriter& = delete ;
+    auto submit(OutputFile &&file) -> void ;  // Waits if the queue is full
+    auto finish() -> void ;  // Waits for everything submitted to be written, and rethrows any error the writer had
+};
+
+#endif /* outputwriter_hpp */
@@ -0,0 +1,241 @@
+//
+
+#include "packer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bmproutine.hpp"
+#include "hash.hpp"
+#include "stats.hpp"
+#include "texturearchive.hpp"
+#include "workpool.hpp"
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    constexpr auto maxId = 0xFFFFF ;
+    //==========================================================================================================================
+    struct Source {
+        int id ;
+        std::filesystem::path path ;
+    };
+    //==========================================================================================================================
+    // A converted texture, ready to be written
+    struct Packed {
+        std::vector<std::uint16_t> pixels ;
+        std::uint32_t flag ;
+        std::uint64_t hash ;
+    };
+    //==========================================================================================================================
+    // The id of a "0x%04X.bmp" file name (any case), or -1 for anything else (like "0x0001_1.bmp", a mip level)
+    auto textureId(const std::string &name) -> int {
+        auto lower = name ;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        if (lower.size() < 10 || lower.size() > 14 || lower.compare(0, 2, "0x") != 0 || lower.compare(lower.size() - 4, 4, ".bmp") != 0) {
+            return -1 ;
+        }
+        auto digits = lower.substr(2, lower.size() - 6) ;
+        if (!std::all_of(digits.begin(), digits.end(), [](unsigned char c){ return std::isxdigit(c) != 0; })) {
+            return -1 ;
+        }
+        auto id = std::stoul(digits, nullptr, 16) ;
+        return id > 0x7FFFFFFF ? -1 : static_cast<int>(id) ;
+    }
+    //==========================================================================================================================
+    auto findSources(const std::filesystem::path &directory) -> std::vector<Source> {
+        if (!std::filesystem::is_directory(directory)) {
+            throw std::runtime_error("Not a directory: "s + directory.string());
+        }
+        auto sources = std::vector<Source>() ;
+        for (const auto &item : std::filesystem::directory_iterator(directory)) {
+            auto id = textureId(item.path().filename().string()) ;
+            if (id >= 0 && item.is_regular_file()) {
+                // The index has an entry for every id up to the highest, so a stray huge id would make a huge index
+                if (id > maxId) {
+                    throw std::runtime_error("The id of "s + item.path().string() + " is too large (the most is 0xFFFFF)"s);
+                }
+                sources.push_back(Source{id, item.path()});
+            }
+        }
+        std::sort(sources.begin(), sources.end(), [](const Source &a, const Source &b){ return a.id < b.id; });
+        // "0x0001.bmp" and "0x00001.bmp" are the same id, and we would not know which one was meant
+        for (auto i = std::size_t(1) ; i < sources.size() ; i++) {
+            if (sources[i].id == sources[i - 1].id) {
+                throw std::runtime_error("Two files for the same id: "s + sources[i - 1].path.string() + " and "s + sources[i].path.string());
+            }
+        }
+        return sources ;
+    }
+    //==========================================================================================================================
+    auto packImage(const Source &source) -> Packed {
+        auto image = loadBmp(source.path) ;
+        Stats::allocated(image.pixels.capacity() * sizeof(std::uint16_t));
+        if (image.width != image.height || (image.width != 64 && image.width != 128)) {
+            throw std::runtime_error(source.path.string() + ": must be 64x64 or 128x128 (it is "s + std::to_string(image.width) + "x"s + std::to_string(image.height) + ")"s);
+        }
+        auto hash = hash64(image.pixels.data(), image.pixels.size() * sizeof(std::uint16_t)) ;
+        return Packed{std::move(image.pixels), image.width == 128 ? 1u : 0u, hash} ;
+    }
+    //==========================================================================================================================
+    // Put the finished (temporary) files in place of the old ones, all or none of them.  The old ones are moved aside
+    // first, and only removed once every new one is in place.  If anything fails, the new ones are taken out and the old
+    // ones put back, so we never leave a new texmaps.mul with an old texidx.mul (or the other way around).
+    auto install(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>> &files) -> void {
+        auto moved = std::vector<std::pair<std::filesystem::path, std::filesystem::path>>() ;  // Old file, where it went
+        auto installed = std::vector<std::filesystem::path>() ;
+        try {
+            for (const auto &[temporary, target] : files) {
+                if (std::filesystem::exists(target)) {
+                    auto aside = target ;
+                    aside += ".old" ;
+                    std::filesystem::rename(target, aside);
+                    moved.emplace_back(target, aside);
+                }
+            }
+            for (const auto &[temporary, target] : files) {
+                std::filesystem::rename(temporary, target);
+                installed.push_back(target);
+            }
+        }
+        catch(...) {
+            auto error = std::error_code() ;
+            for (const auto &path : installed) {
+                std::filesystem::remove(path, error);
+            }
+            for (const auto &[target, aside] : moved) {
+                std::filesystem::rename(aside, target, error);
+            }
+            throw ;
+        }
+        auto error = std::error_code() ;
+        for (const auto &[target, aside] : moved) {
+            std::filesystem::remove(aside, error);
+        }
+    }
+    //==========================================================================================================================
+    auto put(FileData &buffer, std::uint32_t value) -> void {
+        for (auto i = 0 ; i < 4 ; i++) {
+            buffer.push_back(static_cast<std::uint8_t>((value >> (8*i)) & 0xFF));
+        }
+    }
+
+    //==========================================================================================================================
+    // MulWriter
+    //==========================================================================================================================
+    // Appends textures to texmaps.mul, storing each distinct one once.  The file is only ever written to, front to back.
+    // To be sure a texture with the same hash as an earlier one really is the same, we keep the pixels of every
+    // texture written (so memory use grows to the size of texmaps.mul).
+    class MulWriter {
+        struct Stored {
+            TextureEntry entry ;
+            std::vector<std::uint16_t> pixels ;
+        };
+        std::filesystem::path path ;
+        std::ofstream output ;
+        std::uint64_t size ;
+        std::unordered_map<std::uint64_t, std::vector<Stored>> stored ;  // By hash
+    public:
+        explicit MulWriter(const std::filesystem::path &path):path(path),output(path.string(), std::ios::binary),size(0) {
+            if (!output.is_open()) {
+                throw std::runtime_error("Unable to create: "s + path.string());
+            }
+        }
+        //======================================================================================================================
+        // Returns the index entry for the texture, and if it is shared with one written earlier.  The texture's pixels
+        // are kept (if it is a new one), or let go.
+        auto add(Packed &&texture) -> std::pair<TextureEntry, bool> {
+            auto &candidates = stored[texture.hash] ;
+            for (const auto &earlier : candidates) {
+                if (earlier.entry.flag == texture.flag && earlier.pixels == texture.pixels) {
+                    return {earlier.entry, true} ;
+                }
+            }
+            auto bytes = texture.pixels.size() * sizeof(std::uint16_t) ;
+            if (size + bytes > 0xFFFFFFFF) {
+                throw std::runtime_error("Too many textures, texmaps.mul would be over 4GB"s);
+            }
+            auto entry = TextureEntry{static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(bytes), texture.flag} ;
+            output.write(reinterpret_cast<const char*>(texture.pixels.data()), static_cast<std::streamsize>(bytes));
+            size += bytes ;
+            candidates.push_back(Stored{entry, std::move(texture.pixels)});
+            return {entry, false} ;
+        }
+        //======================================================================================================================
+        auto finish() -> std::uint64_t {
+            stored.clear();
+            output.close();
+            if (output.fail()) {
+                throw std::runtime_error("Unable to write: "s + path.string());
+            }
+            return size ;
+        }
+    };
+}
+
+//==============================================================================================================================
+auto packTextures(const std::filesystem::path &directory, const Options &options) -> PackSummary {
+    auto sources = findSources(directory) ;
+    if (sources.empty()) {
+        throw std::runtime_error("No 0x%04X.bmp files in: "s + directory.string());
+    }
+    auto summary = PackSummary{static_cast<std::size_t>(sources.back().id) + 1, sources.size(), 0, 0} ;
+    auto index = std::vector<TextureEntry>(summary.entries, TextureEntry{0xFFFFFFFF, 0, 0}) ;
+    auto mulpath = std::filesystem::path("texmaps.mul") ;
+    auto idxpath = std::filesystem::path("texidx.mul") ;
+    auto mulTemporary = mulpath ;
+    mulTemporary += ".tmp" ;
+    auto idxTemporary = idxpath ;
+    idxTemporary += ".tmp" ;
+
+    auto pool = WorkPool(options.jobs) ;
+    try {
+        auto writer = MulWriter(mulTemporary) ;
+        // A block is converted in parallel, then written in order, before the next is started
+        auto blockSize = static_cast<std::size_t>(pool.size()) * 64 ;
+        auto block = std::vector<Packed>(blockSize) ;
+        for (auto first = std::size_t(0) ; first < sources.size() ; first += blockSize) {
+            auto count = std::min(blockSize, sources.size() - first) ;
+            pool.run(count, [&](std::size_t i, int){
+                auto timer = StageTimer(Stage::encode) ;
+                block[i] = packImage(sources[first + i]) ;
+                Stats::add(Counter::texturesRead);
+            });
+            for (auto i = std::size_t(0) ; i < count ; i++) {
+                auto [entry, shared] = writer.add(std::move(block[i])) ;
+                index[static_cast<std::size_t>(sources[first + i].id)] = entry ;
+                summary.shared += (shared ? 1 : 0) ;
+                block[i] = Packed() ;
+            }
+        }
+        summary.bytes = static_cast<std::size_t>(writer.finish()) ;
+
+        auto data = FileData() ;
+        data.reserve(index.size() * 12) ;
+        for (const auto &entry : index) {
+            put(data, entry.offset);
+            put(data, entry.length);
+            put(data, entry.flag);
+        }
+        saveFile(idxTemporary, data);
+        install({{mulTemporary, mulpath}, {idxTemporary, idxpath}});
+    }
+    catch(...) {
+        auto error = std::error_code() ;
+        std::filesystem::remove(mulTemporary, error);
+        std::filesystem::remove(idxTemporary, error);
+        throw ;
+    }
+    Stats::add(Counter::filesWritten, 2);
+    Stats::add(Counter::bytesWritten, summary.bytes + summary.entries * 12);
+    return summary ;
+}
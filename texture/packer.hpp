@@ -0,0 +1,35 @@
+//
+
+#ifndef packer_hpp
+#define packer_hpp
+
+#include <cstddef>
+#include <filesystem>
+
+#include "options.hpp"
+
+//==============================================================================================================================
+// Pack
+//==============================================================================================================================
+/*
+ The reverse of an export: builds a texidx.mul and texmaps.mul (in the current directory) from a directory of
+ "0x%04X.bmp" files, say after they were edited.  Each file is read back with loadBmp (see bmproutine.hpp), and must
+ be 64x64 or 128x128.  Any other file in the directory (mip levels, atlas pages, ...) is left alone.
+ The images are read and converted on a WorkPool, a block at a time, and each block is then appended to texmaps.mul
+ in id order, so the file is written front to back in one pass (it is never read back).
+ A texture with exactly the same pixels as one already written (compared byte for byte, not just by hash, against
+ the copy of each distinct texture kept in memory) is not stored again, its index entry points at the same data.
+ An id with no file gets an unused entry (offset 0xFFFFFFFF, length 0), and the index ends at the highest id found.
+ Both files are written under a temporary name, and only when both are complete do they replace the old pair
+ together (the old ones are put back if that fails part way), so a failed pack leaves the old ones alone.
+ */
+struct PackSummary {
+    std::size_t entries ;  // Index entries written
+    std::size_t textures ;  // Images packed
+    std::size_t shared ;  // Of those, how many share the data of an earlier one
+    std::size_t bytes ;  // The size of texmaps.mul
+};
+
+auto packTextures(const std::filesystem::path &directory, const Options &options) -> PackSummary ;
+
+#endif /* packer_hpp */
@@ -0,0 +1,213 @@
+//
+
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std::string_literals ;
+
+//======================================================================
+namespace {
+    //==========================================================================================================================
+    // Bucket b holds the times from 2^b up to 2^(b+1) nanoseconds (bucket 0 also holds 0).  48 buckets reach past a day.
+    constexpr auto bucketCount = std::size_t(48) ;
+
+    struct StageRecord {
+        std::atomic<std::uint64_t> runs ;
+        std::atomic<std::uint64_t> nanoseconds ;
+        std::atomic<std::uint64_t> shortest ;
+        std::atomic<std::uint64_t> longest ;
+        std::atomic<std::uint64_t> buckets[bucketCount] ;
+    };
+    // Zero initialized before anything runs (they have no constructors to run), so they can be used from static constructors
+    StageRecord records[stageCount] ;
+
+    //==========================================================================================================================
+    auto bucketFor(std::uint64_t nanoseconds) -> std::size_t {
+        auto bucket = std::size_t(0) ;
+        while (nanoseconds > 1 && bucket < bucketCount - 1) {
+            nanoseconds >>= 1 ;
+            bucket++ ;
+        }
+        return bucket ;
+    }
+    //==========================================================================================================================
+    // An estimate of the time the given share (0 to 1) of the runs took no longer than: the top of the bucket it falls in
+    // (but no more than the longest run)
+    auto percentile(const StageRecord &record, double share) -> std::uint64_t {
+        auto runs = record.runs.load() ;
+        auto wanted = static_cast<std::uint64_t>(static_cast<double>(runs) * share + 0.999999) ;
+        auto seen = std::uint64_t(0) ;
+        for (auto bucket = std::size_t(0) ; bucket < bucketCount ; bucket++) {
+            seen += record.buckets[bucket].load() ;
+            if (seen >= wanted && seen > 0) {
+                return std::min((std::uint64_t(1) << (bucket + 1)) - 1, record.longest.load()) ;
+            }
+        }
+        return record.longest.load() ;
+    }
+    //==========================================================================================================================
+    auto micro(std::uint64_t nanoseconds) -> double {
+        return static_cast<double>(nanoseconds) / 1000.0 ;
+    }
+    //==========================================================================================================================
+    auto number(double value, const char *format = "%.3f") -> std::string {
+        char text[64] ;
+        std::snprintf(text, sizeof(text), format, value);
+        return text ;
+    }
+}
+
+//==============================================================================================================================
+// Names
+//==============================================================================================================================
+//==============================================================================================================================
+auto stageName(Stage stage) -> const char* {
+    switch (stage) {
+        case Stage::total:
+            return "total" ;
+        case Stage::indexParse:
+            return "index_parse" ;
+        case Stage::contentHash:
+            return "content_hash" ;
+        case Stage::plan:
+            return "plan" ;
+        case Stage::encode:
+            return "encode" ;
+        case Stage::mips:
+            return "mips" ;
+        case Stage::draw:
+            return "draw" ;
+        case Stage::submitWait:
+            return "submit_wait" ;
+        case Stage::write:
+            return "write" ;
+        case Stage::link:
+            return "link" ;
+        case Stage::manifest:
+            return "manifest" ;
+    }
+    return "unknown" ;
+}
+//==============================================================================================================================
+auto counterName(Counter counter) -> const char* {
+    switch (counter) {
+        case Counter::entries:
+            return "entries" ;
+        case Counter::texturesRead:
+            return "textures_read" ;
+        case Counter::bytesRead:
+            return "bytes_read" ;
+        case Counter::filesWritten:
+            return "files_written" ;
+        case Counter::bytesWritten:
+            return "bytes_written" ;
+        case Counter::links:
+            return "links" ;
+        case Counter::allocations:
+            return "allocations" ;
+        case Counter::allocatedBytes:
+            return "allocated_bytes" ;
+    }
+    return "unknown" ;
+}
+
+//==============================================================================================================================
+// Stats
+//==============================================================================================================================
+std::atomic<bool> Stats::on{false} ;
+std::atomic<std::uint64_t> Stats::counters[counterCount] ;
+//==============================================================================================================================
+auto Stats::enable() -> void {
+    on.store(true);
+}
+//==============================================================================================================================
+auto Stats::record(Stage stage, std::chrono::nanoseconds elapsed) -> void {
+    auto &record = records[static_cast<std::size_t>(stage)] ;
+    auto nanoseconds = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(elapsed.count(), 0)) ;
+    record.runs.fetch_add(1, std::memory_order_relaxed);
+    record.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    record.buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    // The shortest is kept plus one, so 0 can mean "none yet"
+    auto shortest = record.shortest.load(std::memory_order_relaxed) ;
+    while ((shortest == 0 || nanoseconds + 1 < shortest) && !record.shortest.compare_exchange_weak(shortest, nanoseconds + 1, std::memory_order_relaxed)) {
+    }
+    auto longest = record.longest.load(std::memory_order_relaxed) ;
+    while (nanoseconds > longest && !record.longest.compare_exchange_weak(longest, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+//==============================================================================================================================
+auto Stats::reset() -> void {
+    for (auto &record : records) {
+        record.runs = 0 ;
+        record.nanoseconds = 0 ;
+        record.shortest = 0 ;
+        record.longest = 0 ;
+        for (auto &bucket : record.buckets) {
+            bucket = 0 ;
+        }
+    }
+    for (auto &counter : counters) {
+        counter = 0 ;
+    }
+}
+//==============================================================================================================================
+auto Stats::count(Counter counter) -> std::uint64_t {
+    return counters[static_cast<std::size_t>(counter)].load() ;
+}
+//==============================================================================================================================
+auto Stats::text() -> std::string {
+    auto text = "Stats (per run times in microseconds, seconds for the per texture/file stages are summed over all threads)\n"s ;
+    char line[160] ;
+    std::snprintf(line, sizeof(line), "  %-14s %9s %11s %10s %10s %10s %10s %10s\n", "stage", "runs", "seconds", "mean", "p50", "p90", "p99", "max");
+    text += line ;
+    for (auto index = std::size_t(0) ; index < stageCount ; index++) {
+        const auto &record = records[index] ;
+        auto runs = record.runs.load() ;
+        if (runs == 0) {
+            continue ;
+        }
+        auto nanoseconds = record.nanoseconds.load() ;
+        std::snprintf(line, sizeof(line), "  %-14s %9llu %11.6f %10.1f %10.1f %10.1f %10.1f %10.1f\n", stageName(static_cast<Stage>(index)), static_cast<unsigned long long>(runs), static_cast<double>(nanoseconds) / 1e9, micro(nanoseconds) / static_cast<double>(runs), micro(percentile(record, 0.5)), micro(percentile(record, 0.9)), micro(percentile(record, 0.99)), micro(record.longest.load()));
+        text += line ;
+    }
+    for (auto index = std::size_t(0) ; index < counterCount ; index++) {
+        std::snprintf(line, sizeof(line), "  %-16s %llu\n", counterName(static_cast<Counter>(index)), static_cast<unsigned long long>(counters[index].load()));
+        text += line ;
+    }
+    return text ;
+}
+//==============================================================================================================================
+auto Stats::json() -> std::string {
+    auto text = "{\n  \"stages\": [\n"s ;
+    auto first = true ;
+    for (auto index = std::size_t(0) ; index < stageCount ; index++) {
+        const auto &record = records[index] ;
+        auto runs = record.runs.load() ;
+        if (runs == 0) {
+            continue ;
+        }
+        auto nanoseconds = record.nanoseconds.load() ;
+        text += (first ? ""s : ",\n"s) + "    {\"name\": \""s + stageName(static_cast<Stage>(index)) + "\", \"runs\": "s + std::to_string(runs) + ", \"seconds\": "s + number(static_cast<double>(nanoseconds) / 1e9, "%.9f") ;
+        text += ", \"mean_us\": "s + number(micro(nanoseconds) / static_cast<double>(runs)) + ", \"min_us\": "s + number(micro(record.shortest.load() - 1)) + ", \"max_us\": "s + number(micro(record.longest.load())) ;
+        text += ", \"p50_us\": "s + number(micro(percentile(record, 0.5))) + ", \"p90_us\": "s + number(micro(percentile(record, 0.9))) + ", \"p99_us\": "s + number(micro(percentile(record, 0.99))) ;
+        // Only the buckets that have something in them, each with the time (in microseconds) it goes up to
+        text += ", \"histogram\": ["s ;
+        auto firstBucket = true ;
+        for (auto bucket = std::size_t(0) ; bucket < bucketCount ; bucket++) {
+            auto runsIn = record.buckets[bucket].load() ;
+            if (runsIn > 0) {
+                text += (firstBucket ? ""s : ", "s) + "{\"below_us\": "s + number(micro(std::uint64_t(1) << (bucket + 1))) + ", \"runs\": "s + std::to_string(runsIn) + "}"s ;
+                firstBucket = false ;
+            }
+        }
+        text += "]}"s ;
+        first = false ;
+    }
+    text += (first ? ""s : "\n"s) + "  ],\n  \"counters\": {"s ;
+    for (auto index = std::size_t(0) ; index < counterCount ; index++) {
+        text += (index == 0 ? ""s : ", "s) + "\""s + counterName(static_cast<Counter>(index)) + "\": "s + std::to_string(counters[index].load()) ;
+    }
+    return text + "}\n}\n"s ;
+}
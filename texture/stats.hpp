@@ -0,0 +1,116 @@
+//
+
+#ifndef stats_hpp
+#define stats_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//==============================================================================================================================
+// Stats
+//==============================================================================================================================
+/*
+ Measurements of where an export spends its time (the --stats option).  They are always compiled in, but nothing is
+ measured until Stats::enable is called.  Until then, a StageTimer or Stats::add is one load of a flag and a branch
+ (no clock is read), so leaving them in the code costs close to nothing.
+
+ For each Stage we keep how many times it ran, the total time, and a histogram of how long each run took.  The
+ histogram buckets are powers of two nanoseconds, so from them we can say roughly (to within a factor of two) what
+ the median, 90th and 99th percentile times were.  Some stages run once (reading the index), others once for each
+ texture or file (encoding, writing), on several threads at once.  For those, the total is the time summed over all
+ the threads, so it can be more than the time the export took.
+
+ The Counters are running totals: what was read and written, and the buffers allocated for the image data (each
+ encoded file, mip chain, atlas page, and image read back to pack).  Those are counted where they are made, with
+ Stats::allocated, rather than by replacing operator new, so the rest of the program's allocations cost nothing extra.
+ Everything is kept in atomics, so it can be updated from any thread without a lock.
+ */
+enum class Stage {
+    total,  // The whole run
+    indexParse,  // Opening the files, and reading and checking the index
+    contentHash,  // Hashing the pixels of every entry (for dedup and the manifest)
+    plan,  // Deciding what needs to be done (comparing against the last manifest for an incremental export)
+    encode,  // Encoding one image file (a texture, a mip level, or an atlas page)
+    mips,  // Making the mip chain of one texture
+    draw,  // Copying one texture (and its mip levels) onto the atlas pages
+    submitWait,  // A worker waiting for room to hand a file to the writer (the disk not keeping up)
+    write,  // Writing one file
+    link,  // Making one hard link (dedup link mode)
+    manifest  // Saving the manifest
+};
+constexpr auto stageCount = static_cast<std::size_t>(Stage::manifest) + 1 ;
+
+enum class Counter {
+    entries,  // Index entries
+    texturesRead,  // Textures whose pixels were read to be encoded
+    bytesRead,  // Bytes of the index and of those textures' pixels
+    filesWritten,
+    bytesWritten,
+    links,
+    allocations,  // Image buffers allocated (see Stats::allocated)
+    allocatedBytes  // And their size in bytes
+};
+constexpr auto counterCount = static_cast<std::size_t>(Counter::allocatedBytes) + 1 ;
+
+auto stageName(Stage stage) -> const char* ;
+auto counterName(Counter counter) -> const char* ;
+
+class Stats {
+    static std::atomic<bool> on ;
+    static std::atomic<std::uint64_t> counters[counterCount] ;
+public:
+    static auto enable() -> void ;
+    static auto enabled() -> bool {
+        return on.load(std::memory_order_relaxed) ;
+    }
+    static auto add(Counter counter, std::uint64_t amount = 1) -> void {
+        if (enabled()) {
+            counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+        }
+    }
+    // An image buffer of the given size was allocated
+    static auto allocated(std::size_t bytes) -> void {
+        if (enabled()) {
+            counters[static_cast<std::size_t>(Counter::allocations)].fetch_add(1, std::memory_order_relaxed);
+            counters[static_cast<std::size_t>(Counter::allocatedBytes)].fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+    static auto record(Stage stage, std::chrono::nanoseconds elapsed) -> void ;
+    static auto reset() -> void ;
+    static auto count(Counter counter) -> std::uint64_t ;
+
+    static auto text() -> std::string ;  // A table for people
+    static auto json() -> std::string ;  // The same (and the histograms), for programs
+};
+
+//==============================================================================================================================
+// StageTimer
+//==============================================================================================================================
+// Times from when it is made until stop is called (or it goes out of scope), and records that as one run of the stage
+class StageTimer {
+    Stage stage ;
+    bool running ;
+    std::chrono::steady_clock::time_point start ;
+public:
+    explicit StageTimer(Stage stage):stage(stage),running(Stats::enabled()) {
+        if (running) {
+            start = std::chrono::steady_clock::now() ;
+        }
+    }
+    ~StageTimer() {
+        stop();
+    }
+    StageTimer(const StageTimer &) = delete ;
+    auto operator=(const StageTimer &) -> StageTimer& = delete ;
+    auto stop() -> void {
+        if (running) {
+            running = false ;
+            Stats::record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+        }
+    }
+};
+
+#endif /* stats_hpp */
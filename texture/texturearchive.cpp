@@ -0,0 +1,120 @@
+//
+
+#include "texturearchive.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals ;
+
+//======================================================================
+
+//==============================================================================================================================
+// TextureEntry
+//==============================================================================================================================
+//==============================================================================================================================
+auto TextureEntry::valid() const -> bool {
+    return offset != 0xFFFFFFFF && length != 0 && length != 0xFFFFFFFF ;
+}
+//==============================================================================================================================
+auto TextureEntry::width() const -> int {
+    return (flag == 1 ? 128 : 64) ; // If the flag is 1, it is 128x128, otherwise 64x64
+}
+
+//==============================================================================================================================
+// TextureView
+//==============================================================================================================================
+//==============================================================================================================================
+auto TextureView::row(int line) const -> const std::uint16_t* {
+    return pixels + static_cast<std::size_t>(line) * static_cast<std::size_t>(width) ;
+}
+//==============================================================================================================================
+auto TextureView::size() const -> std::size_t {
+    return static_cast<std::size_t>(width) * static_cast<std::size_t>(width) * 2 ;
+}
+
+//==============================================================================================================================
+// TextureArchive
+//==============================================================================================================================
+//==============================================================================================================================
+TextureArchive::TextureArchive(const std::filesystem::path &idxpath, const std::filesystem::path &mulpath, bool allowMapping) {
+    open(idxpath, mulpath, allowMapping);
+}
+//==============================================================================================================================
+auto TextureArchive::open(const std::filesystem::path &idxpath, const std::filesystem::path &mulpath, bool allowMapping) -> void {
+    close();
+    idxfile.open(idxpath, allowMapping);
+    mulfile.open(mulpath, allowMapping);
+
+    // Any trailing partial record is ignored, the same as a short read would be
+    auto count = idxfile.size() / 12 ;
+    entries.resize(count) ;
+    for (auto id = std::size_t(0) ; id < count ; id++) {
+        std::memcpy(&entries[id], idxfile.data() + id * 12, 12) ;
+    }
+    // Check every entry once, so the views we hand out never point outside the data.  One bad entry should not
+    // cost us all the others, so it is just made unused (as if its offset was 0xFFFFFFFF), and noted.
+    for (auto id = std::size_t(0) ; id < count ; id++) {
+        auto &entry = entries[id] ;
+        if (!entry.valid()) {
+            continue ;
+        }
+        auto needed = static_cast<std::uint64_t>(entry.width()) * static_cast<std::uint64_t>(entry.width()) * 2 ;
+        if (entry.length < needed || (entry.offset % 2) != 0 || static_cast<std::uint64_t>(entry.offset) + needed > mulfile.size()) {
+            char idstring[16] ;
+            std::snprintf(idstring, sizeof(idstring), "0x%04X", static_cast<unsigned>(id));
+            skipped.push_back("Index entry "s + idstring + " does not fit in the data file (offset "s + std::to_string(entry.offset) + ", length "s + std::to_string(entry.length) + "), it was skipped"s);
+            entry = TextureEntry{0xFFFFFFFF, 0, 0} ;
+        }
+    }
+}
+//==============================================================================================================================
+auto TextureArchive::close() -> void {
+    entries.clear();
+    skipped.clear();
+    idxfile.close();
+    mulfile.close();
+}
+//==============================================================================================================================
+auto TextureArchive::mapped() const -> bool {
+    return idxfile.mapped() && mulfile.mapped() ;
+}
+//==============================================================================================================================
+auto TextureArchive::size() const -> std::size_t {
+    return entries.size() ;
+}
+//==============================================================================================================================
+auto TextureArchive::problems() const -> const std::vector<std::string>& {
+    return skipped ;
+}
+//==============================================================================================================================
+auto TextureArchive::entry(int id) const -> const TextureEntry& {
+    return entries.at(static_cast<std::size_t>(id)) ;
+}
+//==============================================================================================================================
+auto TextureArchive::valid(int id) const -> bool {
+    return id >= 0 && static_cast<std::size_t>(id) < entries.size() && entries[static_cast<std::size_t>(id)].valid() ;
+}
+//==============================================================================================================================
+auto TextureArchive::view(int id) const -> TextureView {
+    if (!valid(id)) {
+        throw std::out_of_range("Texture id is not a valid entry: "s + std::to_string(id));
+    }
+    const auto &entry = entries[static_cast<std::size_t>(id)] ;
+    return TextureView{id, entry.width(), reinterpret_cast<const std::uint16_t*>(mulfile.data() + entry.offset)} ;
+}
+//==============================================================================================================================
+auto TextureArchive::width(int id) const -> int {
+    return valid(id) ? entries[static_cast<std::size_t>(id)].width() : 0 ;
+}
+//==============================================================================================================================
+auto TextureArchive::decode(int id, std::uint16_t *buffer, std::size_t count) const -> int {
+    auto texture = view(id) ;
+    if (count < static_cast<std::size_t>(texture.width) * static_cast<std::size_t>(texture.width)) {
+        throw std::length_error("Buffer too small for texture "s + std::to_string(id) + ": "s + std::to_string(count) + " color words"s);
+    }
+    std::memcpy(buffer, texture.pixels, texture.size()) ;
+    return texture.width ;
+}
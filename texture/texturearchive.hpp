@@ -0,0 +1,98 @@
+//
+
+#ifndef texturearchive_hpp
+#define texturearchive_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "mappedfile.hpp"
+
+//======================================================================
+/* UO texture data files
+ The "texidx.mul" file is an index into texmaps.mul file.  it consists of groups three 32 bit integers
+
+ Offset      Size        Purpose
+ 0           4 bytes     Offset in bytes into the texmaps.mul file where the data for this entry resides
+ 4           4 bytes     The length in bytes of the data
+ 8           4 bytes     An indicator if it is a 64x64 (value 0) or a 128x128 (value 1) texture
+
+ An entry is not used if the offset is 0xFFFFFFFF, or the length is 0 (or 0xFFFFFFFF).
+ The texture id is the entry number in the index.
+
+ The texmaps.mul is a file that consists of "pixel data" for the textures. It is streams of 16 bit color values
+ With the size, and coniguration of the entry provided in the texidx.mul file, one can interpret the data.
+ The rows are stored top row first.
+
+ UO 16 bit color value.  UO uses a non alpha 0555 16 bit color scheme. That means the msb (Most signficant bit) is not used.
+ The remaining groups of bits (grouped in 5 bits) rpresent the color value for Red, Green, Blue. It is worth noting
+ that UO did not use "true black" (R:0,G:0,B:0). That was for "no color" or transparent (they did this with stencils back in the day).
+ So the color word looks like this:
+ 15 14 13 12 11 10 09 08 07 06 05 04 03 02 01 00   Bits
+  X  R  R  R  R  R  G  G  G  G  G  B  B  B  B  B
+ */
+
+//==============================================================================================================================
+// TextureEntry
+//==============================================================================================================================
+// One 12 byte record of texidx.mul
+struct TextureEntry {
+    std::uint32_t offset ;
+    std::uint32_t length ;
+    std::uint32_t flag ;
+    auto valid() const -> bool ;
+    auto width() const -> int ;
+};
+
+//==============================================================================================================================
+// TextureView
+//==============================================================================================================================
+// A read only, zero copy view of the pixels of one texture.  The pixels are owned by the TextureArchive
+// the view came from, and are only valid as long as it is open.
+struct TextureView {
+    int id ;
+    int width ;  // Textures are square, so this is also the height
+    const std::uint16_t *pixels ;  // width * width 0555 color words, top row first
+    auto row(int line) const -> const std::uint16_t* ;
+    auto size() const -> std::size_t ;  // The size of the pixel data in bytes
+};
+
+//==============================================================================================================================
+// TextureArchive
+//==============================================================================================================================
+/*
+ Provides access to the textures in a texidx.mul/texmaps.mul pair.
+ Both files are memory mapped (see MappedFile), and the index is parsed and checked once when opened.
+ A valid entry that does not fit inside texmaps.mul (too short for its size, an odd offset, or past the end of the
+ file) is treated as unused, and why is listed in problems.  The rest of the archive is still usable, and after
+ that a view can be handed out without any further checking.
+ Looking up an entry is just an index into the parsed entries, so any texture can be had at any time, in any order.
+ An open archive is only read from, so it can be used from several threads at once.
+ */
+class TextureArchive {
+    MappedFile idxfile ;
+    MappedFile mulfile ;
+    std::vector<TextureEntry> entries ;
+    std::vector<std::string> skipped ;
+public:
+    TextureArchive() = default ;
+    TextureArchive(const std::filesystem::path &idxpath, const std::filesystem::path &mulpath, bool allowMapping = true) ;
+    auto open(const std::filesystem::path &idxpath, const std::filesystem::path &mulpath, bool allowMapping = true) -> void ;
+    auto close() -> void ;
+    auto mapped() const -> bool ;
+
+    auto size() const -> std::size_t ;  // The number of index entries (valid or not)
+    auto problems() const -> const std::vector<std::string>& ;  // Why each entry that did not fit was not used
+    auto entry(int id) const -> const TextureEntry& ;
+    auto valid(int id) const -> bool ;
+    auto view(int id) const -> TextureView ;
+    auto width(int id) const -> int ;  // From the entry's flag, 0 if it is not a valid entry
+    // Copy the pixels of a texture into the caller's buffer, which holds "count" color words, and return its width.
+    // Throws if the id is not a valid entry, or the buffer is too small (width * width are needed)
+    auto decode(int id, std::uint16_t *buffer, std::size_t count) const -> int ;
+};
+
+#endif /* texturearchive_hpp */
@@ -0,0 +1,86 @@
+//
+
+#include "texturecache.hpp"
+
+//==============================================================================================================================
+// DecodedTexture
+//==============================================================================================================================
+//==============================================================================================================================
+auto DecodedTexture::size() const -> std::size_t {
+    return pixels.size() * sizeof(std::uint16_t) ;
+}
+
+//==============================================================================================================================
+// TextureCache
+//==============================================================================================================================
+//==============================================================================================================================
+TextureCache::TextureCache(const TextureArchive &archive, std::size_t capacity):archive(archive),capacity(capacity),used(0),hitCount(0),missCount(0) {
+}
+//==============================================================================================================================
+auto TextureCache::trim(std::size_t room) -> void {
+    while (!recent.empty() && used + room > capacity) {
+        used -= recent.back()->size() ;
+        lookup.erase(recent.back()->id);
+        recent.pop_back();
+    }
+}
+//==============================================================================================================================
+auto TextureCache::get(int id) -> std::shared_ptr<const DecodedTexture> {
+    {
+        auto lock = std::lock_guard<std::mutex>(access) ;
+        auto iter = lookup.find(id) ;
+        if (iter != lookup.end()) {
+            // Move it to the front, it is now the most recently used
+            recent.splice(recent.begin(), recent, iter->second);
+            hitCount++ ;
+            return *iter->second ;
+        }
+        missCount++ ;
+    }
+    // Decoding is done without holding the lock, so other threads are not held up by it
+    auto width = archive.width(id) ;
+    auto texture = std::make_shared<DecodedTexture>() ;
+    texture->id = id ;
+    texture->pixels.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(width)) ;
+    texture->width = archive.decode(id, texture->pixels.data(), texture->pixels.size()) ;
+
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    auto iter = lookup.find(id) ;
+    if (iter != lookup.end()) {
+        return *iter->second ;  // Another thread got there first, use theirs
+    }
+    if (texture->size() <= capacity) {
+        trim(texture->size());
+        recent.push_front(texture);
+        lookup[id] = recent.begin() ;
+        used += texture->size() ;
+    }
+    return texture ;
+}
+//==============================================================================================================================
+auto TextureCache::clear() -> void {
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    recent.clear();
+    lookup.clear();
+    used = 0 ;
+}
+//==============================================================================================================================
+auto TextureCache::hits() const -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    return hitCount ;
+}
+//==============================================================================================================================
+auto TextureCache::misses() const -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    return missCount ;
+}
+//==============================================================================================================================
+auto TextureCache::size() const -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    return lookup.size() ;
+}
+//==============================================================================================================================
+auto TextureCache::bytes() const -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(access) ;
+    return used ;
+}
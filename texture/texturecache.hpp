@@ -0,0 +1,65 @@
+//
+
+#ifndef texturecache_hpp
+#define texturecache_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "filedata.hpp"
+#include "texturearchive.hpp"
+
+//==============================================================================================================================
+// DecodedTexture
+//==============================================================================================================================
+// A texture's pixels, copied out of the archive (so it does not depend on the archive staying open)
+struct DecodedTexture {
+    int id ;
+    int width ;  // Textures are square, so this is also the height
+    // width * width 0555 color words, top row first.  decode writes every one, so they are not zeroed first (see filedata.hpp)
+    std::vector<std::uint16_t, DefaultInitAllocator<std::uint16_t>> pixels ;
+    auto size() const -> std::size_t ;  // The size of the pixel data in bytes
+};
+
+//==============================================================================================================================
+// TextureCache
+//==============================================================================================================================
+/*
+ Keeps the most recently used decoded textures in memory, so a program that asks for the same textures over and over
+ (a renderer, say) does not go back to texmaps.mul for each request.
+ The cache holds at most "capacity" bytes of pixels.  When adding a texture would go over that, the least recently
+ used ones are dropped until it fits (a texture bigger than the whole cache is returned, but not kept).
+ A texture is handed out as a shared_ptr, so one that is dropped from the cache stays valid for anyone still using it.
+ All of it can be used from several threads at once.  Two threads that miss on the same texture at the same time
+ may both decode it, but only one copy is kept.
+ */
+class TextureCache {
+    using Entry = std::shared_ptr<const DecodedTexture> ;
+    const TextureArchive &archive ;
+    std::size_t capacity ;
+    mutable std::mutex access ;
+    std::list<Entry> recent ;  // Most recently used first
+    std::unordered_map<int, std::list<Entry>::iterator> lookup ;
+    std::size_t used ;
+    std::size_t hitCount ;
+    std::size_t missCount ;
+    auto trim(std::size_t room) -> void ;  // Drop the least recently used until there is room for this many more bytes
+public:
+    TextureCache(const TextureArchive &archive, std::size_t capacity) ;
+    TextureCache(const TextureCache &) = delete ;
+    auto operator=(const TextureCache &) -> TextureCache& = delete ;
+    auto get(int id) -> std::shared_ptr<const DecodedTexture> ;  // Throws if the id is not a valid entry
+    auto clear() -> void ;
+
+    auto hits() const -> std::size_t ;
+    auto misses() const -> std::size_t ;
+    auto size() const -> std::size_t ;  // The number of textures held
+    auto bytes() const -> std::size_t ;  // The bytes of pixels held
+};
+
+#endif /* texturecache_hpp */
@@ -0,0 +1,152 @@
+//
+
+#include "workpool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+//======================================================================
+
+//==============================================================================================================================
+// WorkPool
+//==============================================================================================================================
+//==============================================================================================================================
+WorkPool::WorkPool(int workers):workers(std::max(workers,1)),current(nullptr),generation(0),busy(0),stopping(false),failed(false) {
+    queues = std::make_unique<WorkQueue[]>(static_cast<std::size_t>(this->workers)) ;
+    // Worker 0 is whoever calls run
+    for (auto worker = 1 ; worker < this->workers ; worker++) {
+        threads.emplace_back([this, worker]{ wait(worker); });
+    }
+}
+//==============================================================================================================================
+WorkPool::~WorkPool() {
+    {
+        auto lock = std::lock_guard<std::mutex>(access) ;
+        stopping = true ;
+    }
+    started.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+//==============================================================================================================================
+auto WorkPool::size() const -> int {
+    return workers ;
+}
+//==============================================================================================================================
+auto WorkPool::hardwareWorkers() -> int {
+    auto count = static_cast<int>(std::thread::hardware_concurrency()) ;
+    return count > 0 ? count : 1 ;
+}
+//==============================================================================================================================
+// Take from the front of our own queue, and if that is empty, steal from the back of someone else's
+auto WorkPool::take(int worker, std::size_t &index) -> bool {
+    {
+        auto &own = queues[static_cast<std::size_t>(worker)] ;
+        auto lock = std::lock_guard<std::mutex>(own.access) ;
+        if (!own.indices.empty()) {
+            index = own.indices.front() ;
+            own.indices.pop_front();
+            return true ;
+        }
+    }
+    for (auto offset = 1 ; offset < workers ; offset++) {
+        auto &victim = queues[static_cast<std::size_t>((worker + offset) % workers)] ;
+        auto lock = std::lock_guard<std::mutex>(victim.access) ;
+        if (!victim.indices.empty()) {
+            index = victim.indices.back() ;
+            victim.indices.pop_back();
+            return true ;
+        }
+    }
+    return false ;
+}
+//==============================================================================================================================
+// Run tasks until there are none left (or one failed)
+auto WorkPool::work(int worker, const std::function<void(std::size_t, int)> &task) -> void {
+    auto index = std::size_t(0) ;
+    while (!failed.load(std::memory_order_relaxed) && take(worker, index)) {
+        try {
+            task(index, worker);
+        }
+        catch(...) {
+            auto lock = std::lock_guard<std::mutex>(access) ;
+            if (!failure) {
+                failure = std::current_exception() ;
+            }
+            failed = true ;
+        }
+    }
+}
+//==============================================================================================================================
+// What each of our own threads does for the life of the pool: wait for a run, help with it, and wait again
+auto WorkPool::wait(int worker) -> void {
+    auto seen = std::uint64_t(0) ;
+    while (true) {
+        const std::function<void(std::size_t, int)> *task = nullptr ;
+        {
+            auto lock = std::unique_lock<std::mutex>(access) ;
+            started.wait(lock, [&]{ return stopping || generation != seen ;});
+            if (stopping) {
+                return ;
+            }
+            seen = generation ;
+            if (current == nullptr) {
+                continue ;  // We woke too late, that run is already done
+            }
+            task = current ;
+            busy++ ;
+        }
+        work(worker, *task);
+        {
+            auto lock = std::lock_guard<std::mutex>(access) ;
+            busy-- ;
+        }
+        completed.notify_all();
+    }
+}
+//==============================================================================================================================
+auto WorkPool::run(std::size_t count, const std::function<void(std::size_t index, int worker)> &task) -> void {
+    if (workers == 1) {
+        for (auto index = std::size_t(0) ; index < count ; index++) {
+            task(index, 0);
+        }
+        return ;
+    }
+    // Hand each worker a contiguous block of the indices
+    for (auto worker = 0 ; worker < workers ; worker++) {
+        auto &queue = queues[static_cast<std::size_t>(worker)] ;
+        auto first = count * static_cast<std::size_t>(worker) / static_cast<std::size_t>(workers) ;
+        auto last = count * static_cast<std::size_t>(worker + 1) / static_cast<std::size_t>(workers) ;
+        auto lock = std::lock_guard<std::mutex>(queue.access) ;
+        queue.indices.clear();
+        for (auto index = first ; index < last ; index++) {
+            queue.indices.push_back(index);
+        }
+    }
+    {
+        auto lock = std::lock_guard<std::mutex>(access) ;
+        failed = false ;
+        failure = nullptr ;
+        current = &task ;
+        generation++ ;
+    }
+    started.notify_all();
+    work(0, task);
+    // Once we are out of work, every index has been taken, so we only have to wait for the ones still running
+    auto rethrow = std::exception_ptr() ;
+    {
+        auto lock = std::unique_lock<std::mutex>(access) ;
+        completed.wait(lock, [&]{ return busy == 0 ;});
+        current = nullptr ;
+        rethrow = std::exchange(failure, nullptr) ;
+    }
+    for (auto worker = 0 ; worker < workers ; worker++) {
+        auto &queue = queues[static_cast<std::size_t>(worker)] ;
+        auto lock = std::lock_guard<std::mutex>(queue.access) ;
+        queue.indices.clear();
+    }
+    if (rethrow) {
+        std::rethrow_exception(rethrow);
+    }
+}
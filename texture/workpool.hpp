@@ -0,0 +1,63 @@
+//
+
+#ifndef workpool_hpp
+#define workpool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================================================================
+// WorkPool
+//==============================================================================================================================
+/*
+ Runs a task for every index in [0,count) on a number of worker threads.
+ The threads are started once, when the pool is made, and wait between runs, so a run only has to wake them (not
+ create them).  The thread calling run is one of the workers, so a pool of N workers has N-1 threads of its own.
+ The indices are split into one contiguous block per worker, and each worker takes work from the front of
+ its own block.  When a worker runs out, it "steals" from the back of another worker's block, so a worker that
+ happened to get the slow (128x128) textures does not hold everyone else up.
+ If a task throws, the remaining work is abandoned, and the first exception is rethrown from run.
+ With one worker, the tasks are simply run in order on the calling thread.
+ Only one run at a time (from one thread) is allowed.
+ */
+class WorkPool {
+    struct WorkQueue {
+        std::mutex access ;
+        std::deque<std::size_t> indices ;
+    };
+    int workers ;
+    std::unique_ptr<WorkQueue[]> queues ;
+    std::vector<std::thread> threads ;
+    std::mutex access ;
+    std::condition_variable started ;
+    std::condition_variable completed ;
+    const std::function<void(std::size_t, int)> *current ;  // The task of the run in progress (null between runs)
+    std::uint64_t generation ;  // Which run it is, so a thread knows there is a new one
+    int busy ;  // Threads still working on the run
+    bool stopping ;
+    std::atomic<bool> failed ;
+    std::exception_ptr failure ;
+    auto take(int worker, std::size_t &index) -> bool ;
+    auto work(int worker, const std::function<void(std::size_t, int)> &task) -> void ;
+    auto wait(int worker) -> void ;
+public:
+    explicit WorkPool(int workers) ;
+    ~WorkPool() ;
+    WorkPool(const WorkPool &) = delete ;
+    auto operator=(const WorkPool &) -> WorkPool& = delete ;
+    auto size() const -> int ;
+    // The task is given the index to work on, and the number (0 to size()-1) of the worker running it
+    auto run(std::size_t count, const std::function<void(std::size_t index, int worker)> &task) -> void ;
+    static auto hardwareWorkers() -> int ;
+};
+
+#endif /* workpool_hpp */